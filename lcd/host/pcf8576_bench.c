@@ -0,0 +1,130 @@
+/*
+* Copyright (c) 2022 Karoly Molnar
+* SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Host microbenchmarks of the segment rendering core. Every result is
+ * printed as one CSV line:
+ *
+ * BENCH,<operation>,<pattern>,<calls>,<ns/call>
+ *
+ * The optional argument sets the number of calls per operation.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pcf8576_core.h"
+
+#define BENCH_CALLS 10000000UL
+#define BENCH_WIDTH 6
+
+struct bench_result {
+  unsigned long calls;
+  uint64_t ns;
+};
+
+/* keeps the converted digits alive */
+static volatile uint8_t bench_sink;
+
+static uint64_t bench_now(void) {
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+static void bench_report(const char *op, const char *pattern,
+                         const struct bench_result *res) {
+  printf("BENCH,%s,%s,%lu,%.2f\n", op, pattern, res->calls,
+         (double)res->ns / res->calls);
+}
+
+/* times calls evaluations of stmt, i is the iteration index */
+#define BENCH_RUN(res, calls, stmt)                                            \
+  do {                                                                         \
+    uint64_t start = bench_now();                                              \
+    for (unsigned long i = 0; i < (calls); i++) {                              \
+      stmt;                                                                    \
+    }                                                                          \
+    (res)->ns += bench_now() - start;                                          \
+    (res)->calls += (calls);                                                   \
+  } while (0)
+
+/* 1:4 mode digit on outputs 2 and 3, which share a RAM byte */
+static void bench_digit_map(nums_t *map) {
+  static const uint8_t segs[8][2] = {{3, 3}, {2, 3}, {1, 3}, {0, 2},
+                                     {1, 2}, {3, 2}, {2, 2}, {0, 3}};
+
+#ifdef CONFIG_PCF8576_COMPACT_DESCRIPTORS
+  for (int seg = 0; seg < 8; seg++) {
+    map->seg[seg] = PCF8576_SEG_INDEX_MUX(4, segs[seg][0], segs[seg][1]);
+  }
+#else
+  static const uint8_t glyphs[] = {
+      PCF8576_GLYPH_0, PCF8576_GLYPH_1, PCF8576_GLYPH_2,   PCF8576_GLYPH_3,
+      PCF8576_GLYPH_4, PCF8576_GLYPH_5, PCF8576_GLYPH_6,   PCF8576_GLYPH_7,
+      PCF8576_GLYPH_8, PCF8576_GLYPH_9, PCF8576_GLYPH_NEG, PCF8576_GLYPH_DP};
+
+  memset(map, 0, sizeof(*map));
+  map->byte[0] = PCF8576_SEG_BYTE(segs[0][0], segs[0][1]);
+  for (int seg = 0; seg < 8; seg++) {
+    uint8_t mask = PCF8576_SEG_MASK(segs[seg][0], segs[seg][1]);
+
+    map->mask[0] |= mask;
+    for (int glyph = 0; glyph < 12; glyph++) {
+      if (glyphs[glyph] & BIT(seg)) {
+        map->glyph[glyph][0] |= mask;
+      }
+    }
+  }
+#endif
+}
+
+int main(int argc, char *argv[]) {
+  unsigned long calls = argc > 1 ? strtoul(argv[1], NULL, 0) : BENCH_CALLS;
+  uint8_t digits[BENCH_WIDTH];
+  struct pcf8576_write writes[PCF8576_DIGIT_MAX_WRITES];
+  struct bench_result res;
+  nums_t map;
+
+  printf("BENCH,operation,pattern,calls,ns_per_call\n");
+
+  res = (struct bench_result){0};
+  BENCH_RUN(&res, calls,
+            _pcf8576_fixed_to_digits(1234, 0, 0, digits, BENCH_WIDTH);
+            bench_sink = digits[0]);
+  bench_report("int_to_digits", "constant", &res);
+
+  res = (struct bench_result){0};
+  BENCH_RUN(&res, calls,
+            _pcf8576_fixed_to_digits((int32_t)(i * 7919 % 1499999) - 499999,
+                                     0, 0, digits, BENCH_WIDTH);
+            bench_sink = digits[0]);
+  bench_report("int_to_digits", "sweep", &res);
+
+  res = (struct bench_result){0};
+  BENCH_RUN(&res, calls,
+            _pcf8576_fixed_to_digits((int32_t)(i * 7919 % 1499999) - 499999,
+                                     3, 0, digits, BENCH_WIDTH);
+            bench_sink = digits[0]);
+  bench_report("fixed_to_digits", "sweep", &res);
+
+  res = (struct bench_result){0};
+  BENCH_RUN(&res, calls,
+            _pcf8576_float_to_digits((float)(i % 100000) * 1.07f - 500.f,
+                                     digits, BENCH_WIDTH);
+            bench_sink = digits[0]);
+  bench_report("float_to_digits", "sweep", &res);
+
+  bench_digit_map(&map);
+  res = (struct bench_result){0};
+  BENCH_RUN(&res, calls,
+            bench_sink = _pcf8576_digit_writes(&map, i % 10, writes));
+  bench_report("digit_writes", "count", &res);
+
+  return 0;
+}
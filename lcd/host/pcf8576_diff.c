@@ -0,0 +1,469 @@
+/*
+* Copyright (c) 2022 Karoly Molnar
+* SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Differential harness of the segment rendering core. Every converter result
+ * is compared against a reference built on snprintf:
+ *
+ * - integers: every value around the range of 1 to 7 digit displays, plus
+ *   random values over the full int32 range
+ * - fixed point: every mantissa of 4 digit displays with 1..4 decimals, plus
+ *   random mantissas and decimals
+ * - floats: every n-th float below 1e7, n given by --stride (default 257,
+ *   --exhaustive checks every float), against the correctly rounded
+ *   snprintf("%.*f") result; the single precision scaling of the converter
+ *   may be off by one unit of the last digit shown
+ * - digits: random segment layouts rendered through _pcf8576_digit_writes
+ *   against a per segment reference
+ * - RAM layout: segment masks and bytes of every multiplex mode
+ *
+ * Exits with 0 if no mismatch was found.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pcf8576_core.h"
+
+#define MAX_WIDTH 10
+#define REPORT_MAX 10
+
+static unsigned long mismatches;
+static uint32_t rng_state = 0x12345678;
+
+static uint32_t rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static void digits_str(const uint8_t digits[], size_t width, char *out) {
+  for (size_t idx = 0; idx < width; idx++) {
+    uint8_t code = digits[idx];
+
+    if (code == DIGIT_BLANK) {
+      *out++ = '_';
+      continue;
+    }
+    *out++ = code % DIGIT_DP == DIGIT_NEG ? '-' : '0' + code % DIGIT_DP;
+    if (code >= DIGIT_DP) {
+      *out++ = '.';
+    }
+  }
+  *out = '\0';
+}
+
+static void mismatch(const char *what, const uint8_t got[],
+                     const uint8_t expect[], size_t width) {
+  char got_str[2 * MAX_WIDTH + 1];
+  char expect_str[2 * MAX_WIDTH + 1];
+
+  if (mismatches++ < REPORT_MAX) {
+    digits_str(got, width, got_str);
+    digits_str(expect, width, expect_str);
+    printf("MISMATCH %s: got %s expected %s\n", what, got_str, expect_str);
+  }
+}
+
+/* reference of _pcf8576_fixed_to_digits: the value is rounded once to the
+ * most decimals that fit, then formatted with snprintf */
+static void ref_fixed(int64_t mantissa, unsigned int decimals, uint8_t flags,
+                      uint8_t digits[], size_t width) {
+  bool sign = mantissa < 0;
+  uint64_t abs_val = sign ? -(uint64_t)mantissa : (uint64_t)mantissa;
+  char str[32];
+  unsigned int dec = 0;
+  size_t len = 0;
+  bool neg = false;
+
+  for (unsigned int drop = 0; drop <= decimals; drop++) {
+    uint64_t scale = 1;
+
+    for (unsigned int idx = 0; idx < drop; idx++) {
+      scale *= 10;
+    }
+    uint64_t val = (abs_val + scale / 2) / scale;
+
+    dec = decimals - drop;
+    len = snprintf(str, sizeof(str), "%0*llu", (int)dec + 1,
+                   (unsigned long long)val);
+    if (!(flags & PCF8576_NUM_FIXED_DP)) {
+      while (dec > 0 && str[len - 1] == '0') {
+        str[--len] = '\0';
+        dec--;
+      }
+    }
+    neg = sign && val != 0;
+    if (len + neg <= width) {
+      break;
+    }
+  }
+  if (len + neg > width) {
+    memset(digits, DIGIT_NEG, width);
+    return;
+  }
+  size_t pad = width - len;
+
+  for (size_t idx = 0; idx < pad; idx++) {
+    digits[idx] = (flags & PCF8576_NUM_LEADING_ZEROS) ? 0 : DIGIT_BLANK;
+  }
+  if (neg) {
+    digits[(flags & PCF8576_NUM_LEADING_ZEROS) ? 0 : pad - 1] = DIGIT_NEG;
+  }
+  for (size_t idx = 0; idx < len; idx++) {
+    digits[pad + idx] = str[idx] - '0';
+  }
+  if (dec > 0) {
+    digits[pad + len - 1 - dec] += DIGIT_DP;
+  }
+}
+
+static void check_fixed(int64_t mantissa, unsigned int decimals,
+                        uint8_t flags, size_t width) {
+  uint8_t got[MAX_WIDTH];
+  uint8_t expect[MAX_WIDTH];
+
+  _pcf8576_fixed_to_digits((int32_t)mantissa, decimals, flags, got, width);
+  ref_fixed(mantissa, decimals, flags, expect, width);
+  if (memcmp(got, expect, width) != 0) {
+    char what[96];
+
+    snprintf(what, sizeof(what), "fixed %lld/10^%u flags %u width %zu",
+             (long long)mantissa, decimals, flags, width);
+    mismatch(what, got, expect, width);
+  }
+}
+
+static void check_integers(void) {
+  int64_t limit = 1;
+
+  for (size_t width = 1; width <= 7; width++) {
+    limit *= 10;
+    for (int64_t val = -limit / 10 - 100; val <= limit + 100; val++) {
+      check_fixed(val, 0, 0, width);
+      check_fixed(val, 0, PCF8576_NUM_LEADING_ZEROS, width);
+    }
+  }
+  for (int idx = 0; idx < 1000000; idx++) {
+    check_fixed((int32_t)rng(), 0, rng() % 4, 1 + rng() % MAX_WIDTH);
+  }
+  check_fixed(INT32_MIN, 0, 0, MAX_WIDTH);
+  check_fixed(INT32_MAX, 0, 0, MAX_WIDTH);
+}
+
+static void check_fixed_point(void) {
+  for (unsigned int decimals = 1; decimals <= 4; decimals++) {
+    for (int64_t val = -99999; val <= 99999; val++) {
+      for (uint8_t flags = 0; flags < 4; flags++) {
+        check_fixed(val, decimals, flags, 4);
+      }
+    }
+  }
+  for (int idx = 0; idx < 1000000; idx++) {
+    check_fixed((int32_t)rng(), rng() % 10, rng() % 4, 1 + rng() % MAX_WIDTH);
+  }
+}
+
+/* reference of _pcf8576_float_to_digits. The number of decimals follows the
+ * converter: as many as the width allows, while the scaled value fits in an
+ * int32. Returns the number of decimals before trailing zeros are dropped,
+ * -1 on overflow. */
+static int ref_float(float value, uint8_t digits[], size_t width) {
+  double abs_val = fabs((double)value);
+  bool sign = value < 0;
+  char str[64];
+  char *dot;
+
+  if (!(abs_val < (double)(float)INT32_MAX)) {
+    memset(digits, DIGIT_NEG, width);
+    return -1;
+  }
+  size_t int_digits = snprintf(str, sizeof(str), "%u", (uint32_t)abs_val);
+
+  int_digits += sign ? 1 : 0;
+  if (int_digits > width) {
+    memset(digits, DIGIT_NEG, width);
+    return -1;
+  }
+  int decimals = MIN(width - int_digits, 9);
+
+  while (decimals > 0 && abs_val * pow(10, decimals) >= (double)INT32_MAX) {
+    decimals--;
+  }
+  snprintf(str, sizeof(str), "%.*f", decimals, abs_val);
+  dot = strchr(str, '.');
+  if (dot != NULL) {
+    memmove(dot, dot + 1, strlen(dot));
+  }
+  int64_t mantissa = strtoll(str, NULL, 10);
+
+  ref_fixed(sign ? -mantissa : mantissa, decimals, 0, digits, width);
+  return decimals;
+}
+
+/* value of a digit string in units of 10^-9, false on overflow */
+static bool digits_value(const uint8_t digits[], size_t width, int64_t *out) {
+  int64_t val = 0;
+  int decimals = -1;
+  bool neg = false;
+
+  for (size_t idx = 0; idx < width; idx++) {
+    uint8_t code = digits[idx];
+
+    if (code == DIGIT_BLANK) {
+      continue;
+    }
+    if (code % DIGIT_DP == DIGIT_NEG) {
+      if (neg) {
+        return false;
+      }
+      neg = true;
+      continue;
+    }
+    val = val * 10 + code % DIGIT_DP;
+    if (decimals >= 0) {
+      decimals++;
+    }
+    if (code >= DIGIT_DP) {
+      decimals = 0;
+    }
+  }
+  for (int idx = MAX(decimals, 0); idx < 9; idx++) {
+    val *= 10;
+  }
+  *out = neg ? -val : val;
+  return true;
+}
+
+static unsigned long float_checks;
+static unsigned long float_last_digit;
+
+static void check_float(float value, size_t width) {
+  uint8_t got[MAX_WIDTH];
+  uint8_t expect[MAX_WIDTH];
+  int64_t got_val;
+  int64_t expect_val;
+  int decimals;
+
+  float_checks++;
+  _pcf8576_float_to_digits(value, got, width);
+  decimals = ref_float(value, expect, width);
+  if (memcmp(got, expect, width) == 0) {
+    return;
+  }
+  /* tolerated: one unit of the last digit the converter could show */
+  if (decimals >= 0 && digits_value(got, width, &got_val) &&
+      digits_value(expect, width, &expect_val)) {
+    int64_t unit = 1;
+
+    for (int idx = decimals; idx < 9; idx++) {
+      unit *= 10;
+    }
+    if (llabs(got_val - expect_val) <= unit) {
+      float_last_digit++;
+      return;
+    }
+  }
+  char what[64];
+
+  snprintf(what, sizeof(what), "float %.9g width %zu", value, width);
+  mismatch(what, got, expect, width);
+}
+
+static void check_floats(uint32_t stride) {
+  uint32_t limit;
+  float top = 1e7f;
+
+  memcpy(&limit, &top, sizeof(limit));
+  for (uint32_t bits = 0; bits < limit; bits += stride) {
+    float value;
+
+    memcpy(&value, &bits, sizeof(value));
+    check_float(value, 6);
+    check_float(-value, 6);
+    check_float(value, 4);
+  }
+  check_float(NAN, 6);
+  check_float(INFINITY, 6);
+  check_float(-INFINITY, 6);
+  check_float(3e9f, MAX_WIDTH);
+  printf("floats: %lu checked, %lu off by one unit of the last digit\n",
+         float_checks, float_last_digit);
+}
+
+static const uint8_t glyphs[] = {
+    PCF8576_GLYPH_0, PCF8576_GLYPH_1, PCF8576_GLYPH_2,  PCF8576_GLYPH_3,
+    PCF8576_GLYPH_4, PCF8576_GLYPH_5, PCF8576_GLYPH_6,  PCF8576_GLYPH_7,
+    PCF8576_GLYPH_8, PCF8576_GLYPH_9, PCF8576_GLYPH_NEG};
+
+struct layout {
+  uint8_t byte[8];
+  uint8_t mask[8];
+};
+
+/* digit map of a layout, built as the devicetree macros do */
+static void build_map(const struct layout *lay, nums_t *map) {
+#ifdef CONFIG_PCF8576_COMPACT_DESCRIPTORS
+  for (int seg = 0; seg < 8; seg++) {
+    map->seg[seg] = PCF8576_SEG_NONE;
+    for (unsigned int bit = 0; bit < 8 && lay->mask[seg] != 0; bit++) {
+      if (lay->mask[seg] == 0x80 >> bit) {
+        map->seg[seg] = lay->byte[seg] * 8 + bit;
+      }
+    }
+  }
+#else
+  memset(map, 0, sizeof(*map));
+  for (int slot = 0; slot < 8; slot++) {
+    bool used = lay->mask[slot] != 0;
+
+    map->byte[slot] = lay->byte[slot];
+    for (int seg = 0; seg < slot && used; seg++) {
+      used = !(lay->mask[seg] != 0 && lay->byte[seg] == lay->byte[slot]);
+    }
+    if (!used) {
+      continue;
+    }
+    for (int seg = 0; seg < 8; seg++) {
+      if (lay->mask[seg] == 0 || lay->byte[seg] != lay->byte[slot]) {
+        continue;
+      }
+      map->mask[slot] |= lay->mask[seg];
+      for (int glyph = 0; glyph < 12; glyph++) {
+        uint8_t on = glyph < 11 ? glyphs[glyph] : PCF8576_GLYPH_DP;
+
+        if (on & BIT(seg)) {
+          map->glyph[glyph][slot] |= lay->mask[seg];
+        }
+      }
+    }
+  }
+#endif
+}
+
+static void check_digits(void) {
+  static const uint8_t codes[] = {0,  1,  2,  3,  4,  5,  6,  7,  8,
+                                  9,  10, 20, 21, 22, 23, 24, 25, 26,
+                                  27, 28, 29, DIGIT_BLANK};
+
+  for (int round = 0; round < 200000; round++) {
+    uint8_t mux = 1 + rng() % 4;
+    struct layout lay;
+    nums_t map;
+    uint8_t ram[PCF8576_MAX_DEVICES * 20];
+    uint8_t expect[sizeof(ram)];
+    struct pcf8576_write writes[PCF8576_DIGIT_MAX_WRITES];
+
+    /* neighbouring outputs of two devices, some segments unconnected or
+     * undriven */
+    uint16_t span = PCF8576_COLUMNS * 2 - 8;
+#ifdef CONFIG_PCF8576_COMPACT_DESCRIPTORS
+    /* bit indexes address the first 31 RAM bytes */
+    span = MIN(span, PCF8576_SEG_NONE / 8 * PCF8576_COLS_PER_BYTE(mux) - 8);
+#endif
+    uint16_t base = rng() % span;
+
+    for (int seg = 0; seg < 8; seg++) {
+      uint8_t bp = rng() % (mux + 1);
+      uint16_t col = base + rng() % 8;
+
+      lay.mask[seg] = rng() % 8 ? PCF8576_SEG_MASK_MUX(mux, bp, col) : 0;
+      lay.byte[seg] = PCF8576_SEG_BYTE_MUX(mux, bp, col);
+      for (int prev = 0; prev < seg; prev++) {
+        if (lay.mask[prev] == lay.mask[seg] &&
+            lay.byte[prev] == lay.byte[seg]) {
+          lay.mask[seg] = 0;
+        }
+      }
+    }
+    build_map(&lay, &map);
+    for (size_t idx = 0; idx < sizeof(ram); idx++) {
+      ram[idx] = rng();
+    }
+    uint8_t code = codes[rng() % sizeof(codes)];
+    uint8_t on = 0;
+
+    if (code != DIGIT_BLANK) {
+      on = glyphs[code % DIGIT_DP] | (code >= DIGIT_DP ? PCF8576_GLYPH_DP : 0);
+    }
+    memcpy(expect, ram, sizeof(ram));
+    for (int seg = 0; seg < 8; seg++) {
+      if (lay.mask[seg] == 0) {
+        continue;
+      }
+      expect[lay.byte[seg]] &= ~lay.mask[seg];
+      if (on & BIT(seg)) {
+        expect[lay.byte[seg]] |= lay.mask[seg];
+      }
+    }
+    size_t count = _pcf8576_digit_writes(&map, code, writes);
+
+    for (size_t idx = 0; idx < count; idx++) {
+      ram[writes[idx].byte] =
+          (ram[writes[idx].byte] & ~writes[idx].clear) | writes[idx].set;
+    }
+    if (memcmp(ram, expect, sizeof(ram)) != 0 && mismatches++ < REPORT_MAX) {
+      printf("MISMATCH digit code %u mux %u\n", code, mux);
+    }
+  }
+}
+
+static void check_layout(void) {
+  for (uint8_t mux = 1; mux <= 4; mux++) {
+    static uint8_t owner[PCF8576_MAX_DEVICES * 20][8];
+    size_t ram_size = PCF8576_DEV_BYTES(mux) * PCF8576_MAX_DEVICES;
+
+    memset(owner, 0, sizeof(owner));
+    for (uint16_t col = 0; col < PCF8576_COLUMNS * PCF8576_MAX_DEVICES;
+         col++) {
+      for (uint8_t bp = 0; bp < 4; bp++) {
+        unsigned int mask = PCF8576_SEG_MASK_MUX(mux, bp, col);
+        unsigned int byte = PCF8576_SEG_BYTE_MUX(mux, bp, col);
+        unsigned int index = PCF8576_SEG_INDEX_MUX(mux, bp, col);
+        bool writable = bp < mux && !(mux == 3 && bp == 2 &&
+                                             col % PCF8576_COLUMNS % 3 == 2);
+
+        if ((mask != 0) != writable || byte >= ram_size ||
+            (mask != 0 && (index / 8 != byte || 0x80U >> index % 8 != mask)) ||
+            (mask == 0 && index != PCF8576_SEG_NONE)) {
+          if (mismatches++ < REPORT_MAX) {
+            printf("MISMATCH layout mux %u bp %u col %u\n", mux, bp, col);
+          }
+          continue;
+        }
+        if (mask != 0 && owner[byte][index % 8]++ != 0 &&
+            mismatches++ < REPORT_MAX) {
+          printf("MISMATCH layout mux %u bit %u shared\n", mux, index);
+        }
+      }
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t stride = 257;
+
+  for (int idx = 1; idx < argc; idx++) {
+    if (strcmp(argv[idx], "--exhaustive") == 0) {
+      stride = 1;
+    } else if (strcmp(argv[idx], "--stride") == 0 && idx + 1 < argc) {
+      stride = MAX(strtoul(argv[++idx], NULL, 0), 1UL);
+    } else {
+      fprintf(stderr, "usage: %s [--exhaustive | --stride n]\n", argv[0]);
+      return 2;
+    }
+  }
+  check_layout();
+  check_integers();
+  check_fixed_point();
+  check_floats(stride);
+  check_digits();
+  printf("%s (%lu mismatches)\n", mismatches ? "FAILED" : "PASSED",
+         mismatches);
+  return mismatches != 0;
+}
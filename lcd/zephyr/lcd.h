@@ -13,22 +13,201 @@
  * @{
  */
 
+#include <errno.h>
 #include <zephyr/device.h>
+#include <zephyr/sys/util.h>
 #include <zephyr/types.h>
 
+/* the framebuffer returned by get_framebuffer is the driver's RAM mirror */
+#define LCD_CAP_FRAMEBUFFER BIT(0)
+/* frames are shown at once from a hidden RAM bank */
+#define LCD_CAP_BANKED BIT(1)
+/* the controller can blink the display */
+#define LCD_CAP_BLINK BIT(2)
+
+/* lcd_submit: flush once the updates have been applied */
+#define LCD_SUBMIT_FLUSH BIT(0)
+
+/**
+ * @brief Masked write of one byte of the segment RAM.
+ *
+ * The bits in clear are cleared first, then the bits in set are set.
+ */
+struct lcd_segment_update {
+  uint16_t offset;
+  uint8_t clear;
+  uint8_t set;
+};
+
+/**
+ * @brief Segment layout of an LCD controller.
+ *
+ * The segment RAM is ram_size bytes long, laid out as the display RAM of
+ * the controller, e.g. segment output by segment output with one bit per
+ * backplane.
+ */
+struct lcd_capabilities {
+  size_t ram_size;   /* bytes of segment RAM, the framebuffer size */
+  uint16_t segments; /* segment outputs of all cascaded devices */
+  uint8_t backplanes;
+  uint32_t flags; /* LCD_CAP_* */
+};
+
 /**
  * @typedef lcd_api_flush()
  * @brief API for transfering display data to device's RAM
  *
  */
-typedef void (*lcd_api_flush)(const struct device *dev);
+typedef int (*lcd_api_flush)(const struct device *dev);
+/**
+ * @typedef lcd_api_write_segments()
+ * @brief API for replacing len bytes of the segment RAM from offset
+ */
+typedef int (*lcd_api_write_segments)(const struct device *dev,
+                                      const uint8_t *buf, size_t offset,
+                                      size_t len);
+/**
+ * @typedef lcd_api_get_framebuffer()
+ * @brief API for getting the segment RAM owned by the driver
+ */
+typedef void *(*lcd_api_get_framebuffer)(const struct device *dev);
+/**
+ * @typedef lcd_api_capabilities()
+ * @brief API for getting the segment layout of the controller
+ */
+typedef void (*lcd_api_capabilities)(const struct device *dev,
+                                     struct lcd_capabilities *caps);
+/**
+ * @typedef lcd_api_submit()
+ * @brief API for applying a list of masked writes to the segment RAM
+ */
+typedef int (*lcd_api_submit)(const struct device *dev,
+                              const struct lcd_segment_update *updates,
+                              size_t count);
 /**
  * @brief LCD driver API
  *
- * This is the mandatory API any LCD driver needs to expose.
+ * This is the mandatory API any LCD driver needs to expose. The segment RAM
+ * operations are optional.
  */
 __subsystem struct lcd_driver_api {
   lcd_api_flush flush;
+  lcd_api_write_segments write_segments;
+  lcd_api_get_framebuffer get_framebuffer;
+  lcd_api_capabilities capabilities;
+  lcd_api_submit submit;
 };
 
+/**
+ * @brief Transfer the modified part of the segment RAM to the controller.
+ *
+ * @return 0 on success, negative errno code on failure.
+ */
+__syscall int lcd_flush(const struct device *dev);
+
+static inline int z_impl_lcd_flush(const struct device *dev) {
+  const struct lcd_driver_api *api = dev->api;
+
+  return api->flush(dev);
+}
+
+/**
+ * @brief Replace a span of the segment RAM.
+ *
+ * The span is sent by the next flush. When buf points to offset within the
+ * framebuffer of the driver, the bytes written there are taken over without
+ * a copy.
+ *
+ * @return 0 on success, -EINVAL if the span is outside the segment RAM,
+ * -ENOSYS if the driver has no segment RAM interface.
+ */
+__syscall int lcd_write_segments(const struct device *dev, const uint8_t *buf,
+                                 size_t offset, size_t len);
+
+static inline int z_impl_lcd_write_segments(const struct device *dev,
+                                            const uint8_t *buf, size_t offset,
+                                            size_t len) {
+  const struct lcd_driver_api *api = dev->api;
+
+  if (api->write_segments == NULL) {
+    return -ENOSYS;
+  }
+  return api->write_segments(dev, buf, offset, len);
+}
+
+/**
+ * @brief Get the segment RAM owned by the driver.
+ *
+ * Applications may render into it and hand the changed span to
+ * lcd_write_segments. Writes are not synchronised with the widget helpers of
+ * the driver, so a display shall be rendered from one context. Not available
+ * to user mode threads.
+ *
+ * @return the framebuffer, NULL if the driver has none.
+ */
+static inline void *lcd_get_framebuffer(const struct device *dev) {
+  const struct lcd_driver_api *api = dev->api;
+
+  if (api->get_framebuffer == NULL) {
+    return NULL;
+  }
+  return api->get_framebuffer(dev);
+}
+
+/**
+ * @brief Get the segment layout of the controller.
+ *
+ * @return 0 on success, -ENOSYS if the driver does not report it.
+ */
+__syscall int lcd_get_capabilities(const struct device *dev,
+                                   struct lcd_capabilities *caps);
+
+static inline int z_impl_lcd_get_capabilities(const struct device *dev,
+                                              struct lcd_capabilities *caps) {
+  const struct lcd_driver_api *api = dev->api;
+
+  if (api->capabilities == NULL) {
+    return -ENOSYS;
+  }
+  api->capabilities(dev, caps);
+  return 0;
+}
+
+/**
+ * @brief Apply a list of masked writes to the segment RAM.
+ *
+ * Lets a thread change any number of segments, e.g. several widgets, with a
+ * single call, optionally followed by a flush (LCD_SUBMIT_FLUSH). Updates
+ * with an offset at or beyond the ram_size of the controller are skipped
+ * without an error, the others are applied.
+ *
+ * @return 0 on success, -ENOSYS if the driver has no segment RAM interface,
+ * otherwise the error of the flush.
+ */
+__syscall int lcd_submit(const struct device *dev,
+                         const struct lcd_segment_update *updates,
+                         size_t count, uint32_t flags);
+
+static inline int z_impl_lcd_submit(const struct device *dev,
+                                    const struct lcd_segment_update *updates,
+                                    size_t count, uint32_t flags) {
+  const struct lcd_driver_api *api = dev->api;
+  int ret;
+
+  if (api->submit == NULL) {
+    return -ENOSYS;
+  }
+  ret = api->submit(dev, updates, count);
+  if (ret == 0 && (flags & LCD_SUBMIT_FLUSH)) {
+    ret = api->flush(dev);
+  }
+  return ret;
+}
+
+/**
+ * @}
+ */
+
+#include <syscalls/lcd.h>
+
 #endif /* ZEPHYR_INCLUDE_DRIVERS_LCD_H_ */
@@ -0,0 +1,49 @@
+/*
+* Copyright (c) 2022 Karoly Molnar
+* SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/internal/syscall_handler.h>
+
+#include "lcd.h"
+
+static inline int z_vrfy_lcd_flush(const struct device *dev) {
+  K_OOPS(K_SYSCALL_DRIVER_LCD(dev, flush));
+  return z_impl_lcd_flush(dev);
+}
+#include <syscalls/lcd_flush_mrsh.c>
+
+/* the optional operations report -ENOSYS instead of faulting the caller */
+static inline int z_vrfy_lcd_write_segments(const struct device *dev,
+                                            const uint8_t *buf, size_t offset,
+                                            size_t len) {
+  K_OOPS(K_SYSCALL_OBJ(dev, K_OBJ_DRIVER_LCD));
+  K_OOPS(K_SYSCALL_MEMORY_READ(buf, len));
+  return z_impl_lcd_write_segments(dev, buf, offset, len);
+}
+#include <syscalls/lcd_write_segments_mrsh.c>
+
+static inline int z_vrfy_lcd_get_capabilities(const struct device *dev,
+                                              struct lcd_capabilities *caps) {
+  struct lcd_capabilities caps_copy;
+  int ret;
+
+  K_OOPS(K_SYSCALL_OBJ(dev, K_OBJ_DRIVER_LCD));
+  ret = z_impl_lcd_get_capabilities(dev, &caps_copy);
+  if (ret == 0) {
+    K_OOPS(k_usermode_to_copy(caps, &caps_copy, sizeof(caps_copy)));
+  }
+  return ret;
+}
+#include <syscalls/lcd_get_capabilities_mrsh.c>
+
+/* the updates hold no pointers and every offset is checked by the driver,
+ * so they are read in place */
+static inline int z_vrfy_lcd_submit(const struct device *dev,
+                                    const struct lcd_segment_update *updates,
+                                    size_t count, uint32_t flags) {
+  K_OOPS(K_SYSCALL_OBJ(dev, K_OBJ_DRIVER_LCD));
+  K_OOPS(K_SYSCALL_MEMORY_ARRAY_READ(updates, count, sizeof(*updates)));
+  return z_impl_lcd_submit(dev, updates, count, flags);
+}
+#include <syscalls/lcd_submit_mrsh.c>
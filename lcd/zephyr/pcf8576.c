@@ -9,14 +9,29 @@
 #include <zephyr/device.h>
 #include <zephyr/drivers/i2c.h>
 #include <zephyr/kernel.h>
+#include <zephyr/pm/device.h>
 #include <zephyr/sys/__assert.h>
+#include <zephyr/sys/atomic.h>
 
 #include "lcd.h"
 #include "pcf8576.h"
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 #include <zephyr/init.h>
 #include <zephyr/sys/util.h>
+#ifdef CONFIG_PCF8576_STATS
+#include <zephyr/stats/stats.h>
+#endif
+#ifdef CONFIG_PCF8576_STATS_SHELL
+#include <zephyr/shell/shell.h>
+#endif
+#ifdef CONFIG_PCF8576_TX_NOCACHE
+#include <zephyr/linker/section_tags.h>
+#endif
+#ifdef CONFIG_PCF8576_TRACING
+#include <zephyr/tracing/tracing.h>
+#endif
 
 #define LOG_LEVEL CONFIG_LCD_LOG_LEVEL
 #include <zephyr/logging/log.h>
@@ -29,98 +44,991 @@ LOG_MODULE_REGISTER(pcf8576_lcd);
 #define PCF8576_CMD_MODE_SET 0b01000000
 #define PCF8576_CMD_LOAD_DP 0b00000000
 #define PCF8576_CMD_DEVICE_SELECT 0b01100000
+#define PCF8576_CMD_BLINK 0b01110000
+#define PCF8576_CMD_BANK_SELECT 0b01111000
 
-#define DIGIT_BLANK (30)
-#define DIGIT_DP (20)
-#define DIGIT_NEG (10)
-#define SEGMENT_NONE (40) >> 1
+#define PCF8576_BLINK_AB BIT(2)
 
+/* BANK SELECT parameters: input bank I (written) and output bank O (shown) */
+#define PCF8576_BANK(input, output) (((input) << 1) | (output))
+
+#define PCF8576_MODE_ENABLE BIT(3)
+
+/* power state of a device. The display is disabled in both low power states,
+ * an idle device is woken up by the next flush, a suspended one only by a PM
+ * resume. Devices start idle until their chips have been set up. */
+enum {
+  PCF8576_POWER_ACTIVE,
+  PCF8576_POWER_IDLE,
+  PCF8576_POWER_SUSPENDED,
+};
+
+/* the RAM mirror is kept in atomic words so that segments can be changed
+ * from any context without a lock; RAM byte n is bits 8n..8n+7 */
+#define PCF8576_RAM_WORDS(size) ATOMIC_BITMAP_SIZE((size)*8)
+#define PCF8576_RAM_WORD(byte) (((byte)*8) / ATOMIC_BITS)
+#define PCF8576_RAM_SHIFT(byte) (((byte)*8) % ATOMIC_BITS)
+
+/* transmit frame: room for the longest command prefix, the RAM image and one
+ * trailing command byte. The prefix of a transfer is stored right in front of
+ * the first RAM byte sent, so that commands and data leave from a single
+ * buffer. Devices with an alternate RAM bank append the commands and the
+ * blank image that clear it. The frame is aligned and padded to
+ * CONFIG_PCF8576_TX_ALIGN, so it shares no cache line with other data when
+ * sent by DMA. */
+#define PCF8576_TX_CMD_MAX 5
+#define PCF8576_TX_ALT_CMD 4
+#define PCF8576_TX_FRAME_SIZE(ram_size, alt_bank)                              \
+  ROUND_UP(PCF8576_TX_CMD_MAX + (ram_size) + 1 +                               \
+               ((alt_bank) ? PCF8576_TX_ALT_CMD + (ram_size) : 0),             \
+           CONFIG_PCF8576_TX_ALIGN)
+#define PCF8576_TX_RAM(data) (&(data)->tx_frame[PCF8576_TX_CMD_MAX])
+#define PCF8576_TX_TAIL(data, cfg)                                             \
+  (&(data)->tx_frame[PCF8576_TX_CMD_MAX + (cfg)->ram_size])
+#define PCF8576_TX_ALT(data, cfg)                                              \
+  (&(data)->tx_frame[PCF8576_TX_CMD_MAX + (cfg)->ram_size + 1])
+
+#ifdef CONFIG_PCF8576_TX_NOCACHE
+#define PCF8576_TX_SECTION __nocache
+#else
+#define PCF8576_TX_SECTION
+#endif
+
+/* RAM byte and bit mask of a segment descriptor */
+#ifdef CONFIG_PCF8576_COMPACT_DESCRIPTORS
+#define PCF8576_SEG_BYTE_OF(seg) ((seg)[0] / 8)
+#define PCF8576_SEG_MASK_OF(seg)                                               \
+  ((seg)[0] == PCF8576_SEG_NONE ? 0 : 0x80 >> ((seg)[0] % 8))
+#else
+#define PCF8576_SEG_BYTE_OF(seg) ((seg)[1])
+#define PCF8576_SEG_MASK_OF(seg) ((seg)[0])
+#endif
+
+#ifdef CONFIG_PCF8576_STATS
+/* flush latency histogram: bucket n counts the transfers that took less than
+ * 128us << n, the last one all that took longer */
+#define PCF8576_LAT_BUCKETS 8
+#define PCF8576_LAT_FIRST_LOG2 7
+
+STATS_SECT_START(pcf8576_stats)
+STATS_SECT_ENTRY32(flushes)
+STATS_SECT_ENTRY32(bytes)
+STATS_SECT_ENTRY32(errors)
+STATS_SECT_ENTRY32(skipped)
+STATS_SECT_ENTRY32(renders)
+STATS_SECT_ENTRY32(lat_lt_128us)
+STATS_SECT_ENTRY32(lat_lt_256us)
+STATS_SECT_ENTRY32(lat_lt_512us)
+STATS_SECT_ENTRY32(lat_lt_1ms)
+STATS_SECT_ENTRY32(lat_lt_2ms)
+STATS_SECT_ENTRY32(lat_lt_4ms)
+STATS_SECT_ENTRY32(lat_lt_8ms)
+STATS_SECT_ENTRY32(lat_ge_8ms)
+STATS_SECT_END;
+
+STATS_NAME_START(pcf8576_stats)
+STATS_NAME(pcf8576_stats, flushes)
+STATS_NAME(pcf8576_stats, bytes)
+STATS_NAME(pcf8576_stats, errors)
+STATS_NAME(pcf8576_stats, skipped)
+STATS_NAME(pcf8576_stats, renders)
+STATS_NAME(pcf8576_stats, lat_lt_128us)
+STATS_NAME(pcf8576_stats, lat_lt_256us)
+STATS_NAME(pcf8576_stats, lat_lt_512us)
+STATS_NAME(pcf8576_stats, lat_lt_1ms)
+STATS_NAME(pcf8576_stats, lat_lt_2ms)
+STATS_NAME(pcf8576_stats, lat_lt_4ms)
+STATS_NAME(pcf8576_stats, lat_lt_8ms)
+STATS_NAME(pcf8576_stats, lat_ge_8ms)
+STATS_NAME_END(pcf8576_stats);
+
+#define PCF8576_STATS_INC(data, entry) STATS_INC((data)->stats, entry)
+#define PCF8576_STATS_INCN(data, entry, n) STATS_INCN((data)->stats, entry, n)
+#else
+#define PCF8576_STATS_INC(data, entry)
+#define PCF8576_STATS_INCN(data, entry, n)
+#endif
+
+#if defined(CONFIG_PCF8576_TRACING) && defined(CONFIG_TRACING_USER)
+/* the user tracing format has no named events */
+#define PCF8576_TRACE(name, arg0, arg1)                                        \
+  pcf8576_trace_user(name, (uint32_t)(arg0), (uint32_t)(arg1))
+#elif defined(CONFIG_PCF8576_TRACING)
+/* named event of the tracing backend; CTF keeps 20 characters of the name */
+#define PCF8576_TRACE(name, arg0, arg1)                                        \
+  sys_trace_named_event(name, (uint32_t)(arg0), (uint32_t)(arg1))
+#else
+#define PCF8576_TRACE(name, arg0, arg1)
+#endif
 
 struct pcf8576_cfg {
   struct i2c_dt_spec i2c;
+  /* MODE SET parameters without the enable bit */
+  uint8_t mode;
+  /* backplanes: 1..4 */
+  uint8_t mux;
+  /* BLINK parameters set at initialization */
+  uint8_t blink;
+  /* sub-address of the first device of the cascade */
+  uint8_t sub_address;
+  /* RAM bytes of one device in the configured multiplex mode */
+  uint8_t dev_bytes;
+  /* RAM size of all cascaded devices */
+  size_t ram_size;
+  /* frames are written into the hidden RAM bank and shown by BANK SELECT */
+  bool banked;
+  /* bank 1 is unused and cleared by the restore, so that alternate bank
+   * blinking does not show undefined RAM */
+  bool alt_bank;
 };
 
 struct pcf8576_data {
-  uint8_t device_select;
-  uint8_t display_ram[20];
-  int lock_ctr;
-};
-
-static const uint8_t _pcf_8576_segment_data[11] = {
-    0b1111110, // 0
-    0b0110000, // 1
-    0b1101101, // 2
-    0b1111001, // 3
-    0b0110011, // 4
-    0b1011011, // 5
-    0b1011111, // 6
-    0b1110000, // 7
-    0b1111111, // 8
-    0b1111011, // 9
-    0b0000001  // DIGIT_NEG
+  /* back buffer, the widget macros render into it */
+  atomic_t *display_ram;
+  /* RAM bytes changed since the last successful flush, one bitmap per RAM
+   * bank in banked mode */
+  atomic_t *dirty;
+  /* RAM bank being shown in banked mode */
+  uint8_t bank_visible;
+  /* BLINK parameters currently set */
+  uint8_t blink;
+  /* PCF8576_POWER_*, changed with tx_sem held */
+  uint8_t power;
+  /* front buffer, the transmit frame of PCF8576_TX_FRAME_SIZE bytes */
+  uint8_t *tx_frame;
+  struct i2c_msg tx_msgs[2];
+  uint8_t tx_msg_count;
+  uint8_t tx_bank;
+  bool tx_show;
+  bool tx_restore;
+  size_t tx_first;
+  size_t tx_last;
+  /* taken while the front buffer is in use */
+  struct k_sem tx_sem;
+  const struct device *dev;
+#ifdef CONFIG_PCF8576_FLUSH_COALESCE
+  struct k_work_delayable flush_work;
+  int64_t last_flush;
+#endif
+#ifdef CONFIG_PCF8576_IDLE_SUSPEND
+  struct k_work_delayable idle_work;
+#endif
+#ifdef CONFIG_PCF8576_INIT_BACKGROUND
+  struct k_work init_work;
+#endif
+#ifdef CONFIG_PCF8576_ASYNC
+  pcf8576_flush_cb_t tx_cb;
+  void *tx_user_data;
+  /* progress of the device within pcf8576_flush_group */
+  atomic_t group_state;
+  int group_result;
+#endif
+#ifdef CONFIG_PCF8576_STATS
+  STATS_SECT_DECL(pcf8576_stats) stats;
+  /* cycle counter at the start of the running transfer */
+  uint32_t tx_start;
+#endif
+  /* nesting depth of pcf8576_frame_begin */
+  atomic_t frame_ctr;
+  /* incremented by every pcf8576_frame_begin */
+  atomic_t frame_gen;
+  /* a flush was requested while a frame was open */
+  atomic_t flush_deferred;
 };
 
-static const float _pcf8576_p10[] = {1., 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+#ifdef CONFIG_PCF8576_STATS
+/* the latency buckets are separate members of the statistics group */
+static uint32_t *_pcf8576_lat_entry(struct pcf8576_data *data, size_t bucket) {
+  switch (bucket) {
+  case 0:
+    return &data->stats.lat_lt_128us;
+  case 1:
+    return &data->stats.lat_lt_256us;
+  case 2:
+    return &data->stats.lat_lt_512us;
+  case 3:
+    return &data->stats.lat_lt_1ms;
+  case 4:
+    return &data->stats.lat_lt_2ms;
+  case 5:
+    return &data->stats.lat_lt_4ms;
+  case 6:
+    return &data->stats.lat_lt_8ms;
+  default:
+    return &data->stats.lat_ge_8ms;
+  }
+}
+#endif
 
-static void _pcf8576_set(const struct device *dev, const uint8_t data[2]);
-static void _pcf8576_clear(const struct device *dev, const uint8_t data[2]);
-static size_t _pcf8576_count_int_digits(uint32_t number);
-static size_t _pcf8576_count_frac_digits(float val, size_t max_d, uint32_t *fr);
-static void _pcf8576_int_to_digits(uint32_t val, uint8_t digits[], size_t no_digits,
-                                   uint8_t space_digit,bool sign);
+#ifdef CONFIG_PCF8576_WORKQ
+#ifdef CONFIG_PCF8576_WORKQ_DEDICATED
+static K_KERNEL_STACK_DEFINE(_pcf8576_workq_stack,
+                             CONFIG_PCF8576_WORKQ_STACK_SIZE);
+static struct k_work_q _pcf8576_workq;
+static bool _pcf8576_workq_started;
+#define PCF8576_WORKQ (&_pcf8576_workq)
+#else
+#define PCF8576_WORKQ (&k_sys_work_q)
+#endif
+#endif
 
-void _pcf8576_set_digit(const struct device *dev, const uint8_t segment[][2],
+void _pcf8576_set_digit(const struct device *dev, const nums_t *digit,
                         uint8_t value) {
-  int idx = 7;
-  if (value == DIGIT_BLANK) {
-    do {
-      _pcf8576_clear(dev, segment[--idx]);
-    } while (idx > 0);
-  } else {
-    if (segment[7][1] < SEGMENT_NONE) {
-      if (value >= DIGIT_DP) {
-        _pcf8576_set(dev, segment[7]);
-        value -= DIGIT_DP;
-      } else {
-        _pcf8576_clear(dev, segment[7]);
-      }
+  struct pcf8576_write writes[PCF8576_DIGIT_MAX_WRITES];
+  size_t count = _pcf8576_digit_writes(digit, value, writes);
+
+  for (size_t idx = 0; idx < count; idx++) {
+    _pcf8576_update(dev, writes[idx].byte, writes[idx].clear, writes[idx].set);
+  }
+}
+
+/* dirty bitmap of a RAM bank */
+static atomic_t *_pcf8576_dirty(const struct device *dev, uint8_t bank) {
+  const struct pcf8576_cfg *cfg = dev->config;
+  struct pcf8576_data *data = dev->data;
+
+  return &data->dirty[bank * ATOMIC_BITMAP_SIZE(cfg->ram_size)];
+}
+
+static void _pcf8576_mark_dirty(atomic_t *dirty, size_t first, size_t last) {
+  for (size_t idx = first; idx <= last; idx++) {
+    atomic_set_bit(dirty, idx);
+  }
+}
+
+static bool _pcf8576_bank_clean(const struct device *dev, uint8_t bank) {
+  const struct pcf8576_cfg *cfg = dev->config;
+  atomic_t *dirty = _pcf8576_dirty(dev, bank);
+
+  for (size_t word = 0; word < ATOMIC_BITMAP_SIZE(cfg->ram_size); word++) {
+    if (atomic_get(&dirty[word]) != 0) {
+      return false;
     }
-    idx = 7;
-    uint8_t tmp_digit = _pcf_8576_segment_data[value];
-    do {
-      if (tmp_digit & 1) {
-        _pcf8576_set(dev, segment[--idx]);
-      } else {
-        _pcf8576_clear(dev, segment[--idx]);
+  }
+  return true;
+}
+
+#ifdef CONFIG_PCF8576_TRACING
+/* bytes of the transfer set up in the front buffer */
+static uint32_t _pcf8576_tx_bytes(const struct pcf8576_data *data) {
+  uint32_t bytes = 0;
+
+  for (size_t msg = 0; msg < data->tx_msg_count; msg++) {
+    bytes += data->tx_msgs[msg].len;
+  }
+  return bytes;
+}
+#endif
+
+/* Moves the modified span of the back buffer into the front buffer and sets
+ * up its transfer into RAM bank `bank`, followed by a switch of the display
+ * to that bank if `show` is set. Returns false if there is nothing to send.
+ * Must be called with tx_sem held. */
+static bool _pcf8576_flush_prepare(const struct device *dev, uint8_t bank,
+                                   bool show) {
+  const struct pcf8576_cfg *cfg = dev->config;
+  struct pcf8576_data *data = dev->data;
+  atomic_t *dirty = _pcf8576_dirty(dev, bank);
+  size_t first = cfg->ram_size;
+  size_t last = 0;
+  size_t msg = 0;
+
+  /* collect the span of modified bytes, clearing the marks before the data
+   * is copied so that concurrent changes are picked up by the next flush */
+  for (size_t word = 0; word < ATOMIC_BITMAP_SIZE(cfg->ram_size); word++) {
+    atomic_val_t bits = atomic_clear(&dirty[word]);
+
+    if (bits != 0) {
+      first = MIN(first, word * ATOMIC_BITS + __builtin_ctzl(bits));
+      last = word * ATOMIC_BITS + (ATOMIC_BITS - 1) - __builtin_clzl(bits);
+    }
+  }
+  data->tx_first = first;
+  data->tx_last = last;
+  data->tx_bank = bank;
+  data->tx_show = show;
+
+  if (first < cfg->ram_size) {
+    uint8_t *ram = PCF8576_TX_RAM(data);
+    size_t cmd = cfg->banked ? 3 : 2;
+    uint8_t *buf = &ram[first] - cmd;
+
+    atomic_val_t word = 0;
+
+    for (size_t idx = first; idx <= last; idx++) {
+      if (idx == first || PCF8576_RAM_SHIFT(idx) == 0) {
+        word = atomic_get(&data->display_ram[PCF8576_RAM_WORD(idx)]);
       }
-      tmp_digit >>= 1;
-    } while (idx > 0);
+      ram[idx] = (unsigned long)word >> PCF8576_RAM_SHIFT(idx);
+    }
+
+    /* cascaded devices share the I2C address: the data pointer of the device
+     * holding the first byte is loaded, and once its RAM is full the next
+     * device of the cascade continues storing the same data stream */
+    size_t device = first / cfg->dev_bytes;
+    size_t offset = first % cfg->dev_bytes;
+
+    /* the prefix overwrites the image in front of the span, which is not
+     * sent */
+    cmd = 0;
+    if (cfg->banked) {
+      buf[cmd++] = PCF8576_CMD_CONTINUE | PCF8576_CMD_BANK_SELECT |
+                   PCF8576_BANK(bank, data->bank_visible);
+    }
+    buf[cmd++] = PCF8576_CMD_CONTINUE | PCF8576_CMD_LOAD_DP |
+                 (offset * PCF8576_COLS_PER_BYTE(cfg->mux));
+    buf[cmd++] = PCF8576_CMD_LAST | PCF8576_CMD_DEVICE_SELECT |
+                 ((cfg->sub_address + device) & 0x07);
+
+    data->tx_msgs[msg].buf = buf;
+    data->tx_msgs[msg].len = cmd + last - first + 1;
+    data->tx_msgs[msg++].flags = I2C_MSG_WRITE;
   }
+  if (show) {
+    uint8_t *tail = PCF8576_TX_TAIL(data, cfg);
+
+    /* the data stream only ends with a STOP or repeated START, the switch
+     * to the new bank follows as a command of its own */
+    *tail = PCF8576_CMD_LAST | PCF8576_CMD_BANK_SELECT |
+            PCF8576_BANK(bank ^ 1, bank);
+    data->tx_msgs[msg].buf = tail;
+    data->tx_msgs[msg].len = 1;
+    data->tx_msgs[msg].flags = I2C_MSG_WRITE | (msg ? I2C_MSG_RESTART : 0);
+    msg++;
+  }
+  if (msg == 0) {
+    return false;
+  }
+  data->tx_msgs[msg - 1].flags |= I2C_MSG_STOP;
+  data->tx_msg_count = msg;
+  return true;
 }
 
-void pcf8576_flush(const struct device *dev) {
+/* Sets up the transfer of the whole RAM mirror into the shown bank, preceded
+ * by the complete device configuration with the display enabled, so that a
+ * device that lost its RAM while powered down is restored in a single
+ * transaction. The unused alternate bank is cleared first in the same
+ * transaction. Must be called with tx_sem held. */
+static void _pcf8576_restore_prepare(const struct device *dev) {
   const struct pcf8576_cfg *cfg = dev->config;
   struct pcf8576_data *data = dev->data;
-  uint8_t sub_address = (DT_INST_PROP(0, sub_address) & 0x07);
+  uint8_t bank = data->bank_visible;
+  atomic_t *dirty = _pcf8576_dirty(dev, bank);
+
+  for (size_t word = 0; word < ATOMIC_BITMAP_SIZE(cfg->ram_size); word++) {
+    atomic_clear(&dirty[word]);
+  }
+  if (cfg->banked) {
+    _pcf8576_mark_dirty(_pcf8576_dirty(dev, bank ^ 1), 0, cfg->ram_size - 1);
+  }
+  uint8_t *ram = PCF8576_TX_RAM(data);
+
+  for (size_t idx = 0; idx < cfg->ram_size; idx++) {
+    ram[idx] =
+        (unsigned long)atomic_get(&data->display_ram[PCF8576_RAM_WORD(idx)]) >>
+        PCF8576_RAM_SHIFT(idx);
+  }
+  data->tx_first = 0;
+  data->tx_last = cfg->ram_size - 1;
+  data->tx_bank = bank;
+  data->tx_show = false;
+  data->tx_restore = true;
 
-  uint8_t cmd = PCF8576_CMD_CONTINUE | PCF8576_CMD_LOAD_DP | 0;
+  /* MODE SET, BLINK and BANK SELECT are accepted by all devices of the
+   * cascade */
+  data->tx_frame[0] = PCF8576_CMD_CONTINUE | PCF8576_CMD_MODE_SET |
+                      PCF8576_MODE_ENABLE | cfg->mode;
+  data->tx_frame[1] = PCF8576_CMD_CONTINUE | PCF8576_CMD_BLINK | data->blink;
+  data->tx_frame[2] = PCF8576_CMD_CONTINUE | PCF8576_CMD_BANK_SELECT |
+                      PCF8576_BANK(bank, bank);
+  data->tx_frame[3] = PCF8576_CMD_CONTINUE | PCF8576_CMD_LOAD_DP;
+  data->tx_frame[4] =
+      PCF8576_CMD_LAST | PCF8576_CMD_DEVICE_SELECT | cfg->sub_address;
+  size_t msg = 0;
 
-  data->device_select =
-      PCF8576_CMD_LAST | PCF8576_CMD_DEVICE_SELECT | sub_address;
+  if (cfg->alt_bank) {
+    uint8_t *alt = PCF8576_TX_ALT(data, cfg);
 
-  if (i2c_burst_write_dt(&cfg->i2c, cmd, &data->device_select,
-                         sizeof(data->display_ram) + 1)) {
+    /* the display stays disabled until the shown bank has been written, the
+     * input bank is set back to 0 by the restore itself */
+    alt[0] = PCF8576_CMD_CONTINUE | PCF8576_CMD_MODE_SET | cfg->mode;
+    alt[1] =
+        PCF8576_CMD_CONTINUE | PCF8576_CMD_BANK_SELECT | PCF8576_BANK(1, 0);
+    alt[2] = PCF8576_CMD_CONTINUE | PCF8576_CMD_LOAD_DP;
+    alt[3] = PCF8576_CMD_LAST | PCF8576_CMD_DEVICE_SELECT | cfg->sub_address;
+    memset(&alt[PCF8576_TX_ALT_CMD], 0, cfg->ram_size);
+    data->tx_msgs[msg].buf = alt;
+    data->tx_msgs[msg].len = PCF8576_TX_ALT_CMD + cfg->ram_size;
+    data->tx_msgs[msg++].flags = I2C_MSG_WRITE;
+  }
+  data->tx_msgs[msg].buf = data->tx_frame;
+  data->tx_msgs[msg].len = PCF8576_TX_CMD_MAX + cfg->ram_size;
+  data->tx_msgs[msg].flags =
+      I2C_MSG_WRITE | I2C_MSG_STOP | (msg ? I2C_MSG_RESTART : 0);
+  data->tx_msg_count = msg + 1;
+}
+
+/* Marks the span of the front buffer as modified again, so that it is sent
+ * by the next flush. */
+static void _pcf8576_flush_unprepare(const struct device *dev) {
+  const struct pcf8576_cfg *cfg = dev->config;
+  struct pcf8576_data *data = dev->data;
+
+  if (data->tx_first < cfg->ram_size) {
+    _pcf8576_mark_dirty(_pcf8576_dirty(dev, data->tx_bank), data->tx_first,
+                        data->tx_last);
+  }
+  data->tx_restore = false;
+}
+
+/* Called right before a prepared transfer is handed to the bus. */
+static void _pcf8576_tx_start(const struct device *dev) {
+  const struct pcf8576_cfg *cfg = dev->config;
+  struct pcf8576_data *data = dev->data;
+
+  ARG_UNUSED(cfg);
+  ARG_UNUSED(data);
+#ifdef CONFIG_PCF8576_STATS
+  data->tx_start = k_cycle_get_32();
+#endif
+  PCF8576_TRACE("lcd_flush_start", _pcf8576_tx_bytes(data), cfg->i2c.addr);
+}
+
+/* Completes a transfer started by _pcf8576_flush_prepare or
+ * _pcf8576_restore_prepare. May be called from ISR context. */
+static void _pcf8576_flush_done(const struct device *dev, int result) {
+  const struct pcf8576_cfg *cfg = dev->config;
+  struct pcf8576_data *data = dev->data;
+
+#ifdef CONFIG_PCF8576_STATS
+  uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - data->tx_start);
+  size_t bucket = 0;
+
+  if (us >= BIT(PCF8576_LAT_FIRST_LOG2)) {
+    bucket = MIN((31 - __builtin_clz(us)) - PCF8576_LAT_FIRST_LOG2 + 1,
+                 PCF8576_LAT_BUCKETS - 1);
+  }
+  (*_pcf8576_lat_entry(data, bucket))++;
+  PCF8576_STATS_INC(data, flushes);
+  for (size_t msg = 0; msg < data->tx_msg_count; msg++) {
+    PCF8576_STATS_INCN(data, bytes, data->tx_msgs[msg].len);
+  }
+#endif
+  if (result) {
     LOG_ERR("Writing to PCF8576 device @%d on bus %s has failed", cfg->i2c.addr,
             cfg->i2c.bus->name);
+    PCF8576_STATS_INC(data, errors);
+    PCF8576_TRACE("lcd_i2c_error", -result, cfg->i2c.addr);
+    /* retry the whole span on the next flush */
+    _pcf8576_flush_unprepare(dev);
+  } else {
+    if (data->tx_show) {
+      data->bank_visible = data->tx_bank;
+    }
+    if (data->tx_restore) {
+      data->power = PCF8576_POWER_ACTIVE;
+    }
+#ifdef CONFIG_PCF8576_IDLE_SUSPEND
+    k_work_reschedule_for_queue(PCF8576_WORKQ, &data->idle_work,
+                                K_SECONDS(CONFIG_PCF8576_IDLE_TIMEOUT_S));
+#endif
+  }
+  data->tx_restore = false;
+  PCF8576_TRACE("lcd_flush_end", _pcf8576_tx_bytes(data), -result);
+}
+
+/* Completes a transfer and releases the front buffer. May be called from ISR
+ * context. */
+static void _pcf8576_flush_complete(const struct device *dev, int result) {
+  struct pcf8576_data *data = dev->data;
+
+  _pcf8576_flush_done(dev, result);
+  k_sem_give(&data->tx_sem);
+}
+
+/* Wakes an idle device up with a synchronous restore. Must be called with
+ * tx_sem held. */
+static int _pcf8576_wake(const struct device *dev) {
+  const struct pcf8576_cfg *cfg = dev->config;
+  struct pcf8576_data *data = dev->data;
+  int ret;
+
+  if (data->power != PCF8576_POWER_IDLE) {
+    return 0;
   }
-  LOG_HEXDUMP_DBG(data->display_ram, sizeof(data->display_ram), "display_ram");
+  _pcf8576_restore_prepare(dev);
+  _pcf8576_tx_start(dev);
+  ret = i2c_transfer_dt(&cfg->i2c, data->tx_msgs, data->tx_msg_count);
+  _pcf8576_flush_done(dev, ret);
+  return ret;
+}
+
+/* Flushes requested while a frame is open are performed by its commit. The
+ * request is recorded before the frame depth is read, so that a commit
+ * running in between cannot miss it. */
+static bool _pcf8576_flush_defer(struct pcf8576_data *data) {
+  atomic_set(&data->flush_deferred, 1);
+  if (atomic_get(&data->frame_ctr) > 0) {
+    return true;
+  }
+  atomic_clear(&data->flush_deferred);
+  return false;
 }
 
+/* Sets up the transfer of a frame: in banked mode it is written into the
+ * hidden bank which is shown afterwards. Must be called with tx_sem held. */
+static bool _pcf8576_flush_setup_once(const struct device *dev) {
+  const struct pcf8576_cfg *cfg = dev->config;
+  struct pcf8576_data *data = dev->data;
+
+  switch (data->power) {
+  case PCF8576_POWER_SUSPENDED:
+    return false; /* the changes stay marked until the resume */
+  case PCF8576_POWER_IDLE:
+    _pcf8576_restore_prepare(dev);
+    return true;
+  default:
+    break;
+  }
+  if (!cfg->banked) {
+    return _pcf8576_flush_prepare(dev, 0, false);
+  }
+  /* the shown bank is up to date as long as nothing has been marked in its
+   * bitmap, the hidden one may still lack changes already shown */
+  if (_pcf8576_bank_clean(dev, data->bank_visible)) {
+    return false;
+  }
+  return _pcf8576_flush_prepare(dev, data->bank_visible ^ 1, true);
+}
+
+/* Sets up the transfer of a consistent frame. A frame begun while the mirror
+ * was being copied may have been picked up partially: the copy is then
+ * discarded and taken again, which defers it to the commit while the frame
+ * is still open. Must be called with tx_sem held. */
+static bool _pcf8576_flush_setup(const struct device *dev) {
+  struct pcf8576_data *data = dev->data;
+
+  for (;;) {
+    atomic_val_t gen = atomic_get(&data->frame_gen);
+
+    if (_pcf8576_flush_defer(data)) {
+      return false;
+    }
+    if (!_pcf8576_flush_setup_once(dev)) {
+      return false;
+    }
+    if (atomic_get(&data->frame_gen) == gen) {
+      break;
+    }
+    _pcf8576_flush_unprepare(dev);
+  }
+  _pcf8576_tx_start(dev);
+  return true;
+}
+
+/* Releases the front buffer when there was nothing to transfer. */
+static void _pcf8576_flush_skip(const struct device *dev) {
+  struct pcf8576_data *data = dev->data;
+
+  PCF8576_STATS_INC(data, skipped);
+  k_sem_give(&data->tx_sem);
+}
+
+int pcf8576_flush(const struct device *dev) {
+  const struct pcf8576_cfg *cfg = dev->config;
+  struct pcf8576_data *data = dev->data;
+  int ret = 0;
+
+  k_sem_take(&data->tx_sem, K_FOREVER);
+  if (!_pcf8576_flush_setup(dev)) {
+    _pcf8576_flush_skip(dev);
+    return 0; /* nothing has changed since the last flush */
+  }
+  ret = i2c_transfer_dt(&cfg->i2c, data->tx_msgs, data->tx_msg_count);
+  if (data->tx_first < cfg->ram_size) {
+    LOG_HEXDUMP_DBG(&PCF8576_TX_RAM(data)[data->tx_first],
+                    data->tx_last - data->tx_first + 1, "display_ram");
+  }
+  _pcf8576_flush_complete(dev, ret);
+  return ret;
+}
+
+int pcf8576_flush_bank(const struct device *dev, uint8_t bank) {
+  const struct pcf8576_cfg *cfg = dev->config;
+  struct pcf8576_data *data = dev->data;
+  atomic_val_t gen;
+  int ret;
+
+  if (!cfg->banked) {
+    return -ENOTSUP;
+  }
+  if (bank > 1) {
+    return -EINVAL;
+  }
+  k_sem_take(&data->tx_sem, K_FOREVER);
+  gen = atomic_get(&data->frame_gen);
+  if (atomic_get(&data->frame_ctr) > 0) {
+    k_sem_give(&data->tx_sem);
+    return -EBUSY;
+  }
+  ret = _pcf8576_wake(dev);
+  if (ret == 0 && data->power == PCF8576_POWER_SUSPENDED) {
+    ret = -EBUSY;
+  }
+  if (ret) {
+    k_sem_give(&data->tx_sem);
+    return ret;
+  }
+  if (!_pcf8576_flush_prepare(dev, bank, false)) {
+    _pcf8576_flush_skip(dev);
+    return 0;
+  }
+  if (atomic_get(&data->frame_gen) != gen) {
+    /* a frame has been begun during the copy */
+    _pcf8576_flush_unprepare(dev);
+    k_sem_give(&data->tx_sem);
+    return -EBUSY;
+  }
+  _pcf8576_tx_start(dev);
+  ret = i2c_transfer_dt(&cfg->i2c, data->tx_msgs, data->tx_msg_count);
+  _pcf8576_flush_complete(dev, ret);
+  return ret;
+}
+
+void pcf8576_frame_begin(const struct device *dev) {
+  struct pcf8576_data *data = dev->data;
+
+  atomic_inc(&data->frame_ctr);
+  atomic_inc(&data->frame_gen);
+}
+
+int pcf8576_frame_commit(const struct device *dev) {
+  struct pcf8576_data *data = dev->data;
+
+  __ASSERT(atomic_get(&data->frame_ctr) > 0, "frame commit without begin");
+  if (atomic_dec(&data->frame_ctr) != 1 ||
+      !atomic_clear(&data->flush_deferred)) {
+    return 0;
+  }
+  if (k_is_in_isr()) {
+#ifdef CONFIG_PCF8576_FLUSH_COALESCE
+    pcf8576_flush_request(dev);
+#else
+    /* the changes stay marked, the next flush sends them */
+#endif
+    return 0;
+  }
+  return pcf8576_flush(dev);
+}
+
+int pcf8576_bank_show(const struct device *dev, uint8_t bank) {
+  const struct pcf8576_cfg *cfg = dev->config;
+  struct pcf8576_data *data = dev->data;
+  int ret;
+
+  if (!cfg->banked) {
+    return -ENOTSUP;
+  }
+  if (bank > 1) {
+    return -EINVAL;
+  }
+  k_sem_take(&data->tx_sem, K_FOREVER);
+  ret = _pcf8576_wake(dev);
+  if (ret == 0 && data->power == PCF8576_POWER_SUSPENDED) {
+    ret = -EBUSY;
+  }
+  if (ret == 0) {
+    uint8_t *tail = PCF8576_TX_TAIL(data, cfg);
+
+    *tail = PCF8576_CMD_LAST | PCF8576_CMD_BANK_SELECT |
+            PCF8576_BANK(bank ^ 1, bank);
+    ret = i2c_write_dt(&cfg->i2c, tail, 1);
+  }
+  if (ret) {
+    PCF8576_TRACE("lcd_i2c_error", -ret, cfg->i2c.addr);
+  }
+  if (ret == 0) {
+    data->bank_visible = bank;
+  }
+  k_sem_give(&data->tx_sem);
+  return ret;
+}
+
+#ifdef CONFIG_PCF8576_ASYNC
+static void _pcf8576_i2c_cb(const struct device *i2c_dev, int result,
+                            void *user_data) {
+  const struct device *dev = user_data;
+  struct pcf8576_data *data = dev->data;
+  pcf8576_flush_cb_t cb = data->tx_cb;
+  void *cb_user_data = data->tx_user_data;
+
+  _pcf8576_flush_complete(dev, result);
+  if (cb != NULL) {
+    cb(dev, result, cb_user_data);
+  }
+}
+
+static int _pcf8576_flush_start(const struct device *dev,
+                                pcf8576_flush_cb_t cb, void *user_data,
+                                k_timeout_t timeout) {
+  const struct pcf8576_cfg *cfg = dev->config;
+  struct pcf8576_data *data = dev->data;
+  int ret;
+
+  if (k_sem_take(&data->tx_sem, timeout)) {
+    return -EBUSY;
+  }
+  if (!_pcf8576_flush_setup(dev)) {
+    _pcf8576_flush_skip(dev);
+    if (cb != NULL) {
+      cb(dev, 0, user_data);
+    }
+    return 0;
+  }
+  data->tx_cb = cb;
+  data->tx_user_data = user_data;
+  ret = i2c_transfer_cb_dt(&cfg->i2c, data->tx_msgs, data->tx_msg_count,
+                           _pcf8576_i2c_cb, (void *)dev);
+  if (ret == -ENOSYS) {
+    /* the controller has no callback support, e.g. the I2C emulator:
+     * transfer in the caller and complete like the controller would */
+    ret = i2c_transfer_dt(&cfg->i2c, data->tx_msgs, data->tx_msg_count);
+    _pcf8576_i2c_cb(cfg->i2c.bus, ret, (void *)dev);
+    return 0;
+  }
+  if (ret) {
+    _pcf8576_flush_complete(dev, ret);
+  }
+  return ret;
+}
+
+int pcf8576_flush_async(const struct device *dev, pcf8576_flush_cb_t cb,
+                        void *user_data) {
+  return _pcf8576_flush_start(dev, cb, user_data, K_NO_WAIT);
+}
+
+static void _pcf8576_signal_cb(const struct device *dev, int result,
+                               void *user_data) {
+  k_poll_signal_raise(user_data, result);
+}
+
+int pcf8576_flush_signal(const struct device *dev, struct k_poll_signal *sig) {
+  return pcf8576_flush_async(dev, _pcf8576_signal_cb, sig);
+}
+
+enum {
+  PCF8576_GROUP_QUEUED,
+  PCF8576_GROUP_RUNNING,
+  PCF8576_GROUP_DONE,
+};
+
+static void _pcf8576_group_cb(const struct device *dev, int result,
+                              void *user_data) {
+  struct pcf8576_data *data = dev->data;
+
+  data->group_result = result;
+  atomic_set(&data->group_state, PCF8576_GROUP_DONE);
+  k_sem_give(user_data);
+}
+
+/* true if a transfer of another group member is running on the bus of
+ * devs[idx] */
+static bool _pcf8576_group_bus_busy(const struct device *const devs[],
+                                    size_t count, size_t idx) {
+  const struct pcf8576_cfg *cfg = devs[idx]->config;
+
+  for (size_t other = 0; other < count; other++) {
+    const struct pcf8576_cfg *other_cfg = devs[other]->config;
+    struct pcf8576_data *other_data = devs[other]->data;
+
+    if (other_cfg->i2c.bus == cfg->i2c.bus &&
+        atomic_get(&other_data->group_state) == PCF8576_GROUP_RUNNING) {
+      return true;
+    }
+  }
+  return false;
+}
+
+int pcf8576_flush_group(const struct device *const devs[], size_t count) {
+  struct k_sem done;
+  size_t finished = 0;
+  int ret = 0;
+
+  k_sem_init(&done, 0, count);
+  for (size_t idx = 0; idx < count; idx++) {
+    struct pcf8576_data *data = devs[idx]->data;
+
+    atomic_set(&data->group_state, PCF8576_GROUP_QUEUED);
+    data->group_result = 0;
+  }
+
+  while (finished < count) {
+    /* start the first queued device on every idle bus, the transfers of
+     * devices sharing a bus are started one after the other */
+    for (size_t idx = 0; idx < count; idx++) {
+      struct pcf8576_data *data = devs[idx]->data;
+
+      if (atomic_get(&data->group_state) != PCF8576_GROUP_QUEUED ||
+          _pcf8576_group_bus_busy(devs, count, idx)) {
+        continue;
+      }
+      atomic_set(&data->group_state, PCF8576_GROUP_RUNNING);
+      int err = _pcf8576_flush_start(devs[idx], _pcf8576_group_cb, &done,
+                                     K_FOREVER);
+      if (err) {
+        _pcf8576_group_cb(devs[idx], err, &done);
+      }
+    }
+    k_sem_take(&done, K_FOREVER);
+    finished++;
+  }
+
+  for (size_t idx = 0; idx < count; idx++) {
+    struct pcf8576_data *data = devs[idx]->data;
+
+    if (data->group_result < 0 && ret == 0) {
+      ret = data->group_result;
+    }
+  }
+  return ret;
+}
+#endif
+
+#ifdef CONFIG_PCF8576_FLUSH_COALESCE
+static void _pcf8576_flush_work(struct k_work *work) {
+  struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+  struct pcf8576_data *data =
+      CONTAINER_OF(dwork, struct pcf8576_data, flush_work);
+
+  data->last_flush = k_uptime_get();
+  (void)pcf8576_flush(data->dev);
+}
+
+void pcf8576_flush_request(const struct device *dev) {
+  struct pcf8576_data *data = dev->data;
+  int64_t delay = data->last_flush + CONFIG_PCF8576_FLUSH_PERIOD_MS -
+                  k_uptime_get();
+
+  /* does nothing if a flush is already scheduled, so that all requests
+   * until then are served by that single transfer */
+  k_work_schedule_for_queue(PCF8576_WORKQ, &data->flush_work,
+                            K_MSEC(MAX(delay, 0)));
+}
+#endif
+
+/* Disables the display, the RAM contents are kept in the mirror. Must be
+ * called with tx_sem held. */
+static int _pcf8576_power_down(const struct device *dev, uint8_t state) {
+  const struct pcf8576_cfg *cfg = dev->config;
+  struct pcf8576_data *data = dev->data;
+  uint8_t *tail = PCF8576_TX_TAIL(data, cfg);
+  int ret = 0;
+
+  if (data->power == PCF8576_POWER_ACTIVE) {
+    *tail = PCF8576_CMD_LAST | PCF8576_CMD_MODE_SET | cfg->mode;
+    ret = i2c_write_dt(&cfg->i2c, tail, 1);
+  }
+  if (ret) {
+    PCF8576_TRACE("lcd_i2c_error", -ret, cfg->i2c.addr);
+  }
+  if (ret == 0) {
+    data->power = state;
+  }
+  return ret;
+}
+
+#ifdef CONFIG_PCF8576_IDLE_SUSPEND
+static void _pcf8576_idle_work(struct k_work *work) {
+  struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+  struct pcf8576_data *data =
+      CONTAINER_OF(dwork, struct pcf8576_data, idle_work);
+
+  /* a transfer in progress restarts the timeout when it completes */
+  if (k_sem_take(&data->tx_sem, K_NO_WAIT)) {
+    return;
+  }
+  if (data->power == PCF8576_POWER_ACTIVE) {
+    (void)_pcf8576_power_down(data->dev, PCF8576_POWER_IDLE);
+  }
+  k_sem_give(&data->tx_sem);
+}
+#endif
+
+#ifdef CONFIG_PM_DEVICE
+static int pcf8576_pm_action(const struct device *dev,
+                             enum pm_device_action action) {
+  const struct pcf8576_cfg *cfg = dev->config;
+  struct pcf8576_data *data = dev->data;
+  int ret;
+
+  switch (action) {
+  case PM_DEVICE_ACTION_SUSPEND:
+    if (k_sem_take(&data->tx_sem, K_NO_WAIT)) {
+      return -EBUSY;
+    }
+    ret = _pcf8576_power_down(dev, PCF8576_POWER_SUSPENDED);
+    k_sem_give(&data->tx_sem);
+    return ret;
+  case PM_DEVICE_ACTION_RESUME:
+    /* the RAM may have been lost, the whole frame is sent again */
+    k_sem_take(&data->tx_sem, K_FOREVER);
+    _pcf8576_restore_prepare(dev);
+    _pcf8576_tx_start(dev);
+    ret = i2c_transfer_dt(&cfg->i2c, data->tx_msgs, data->tx_msg_count);
+    _pcf8576_flush_complete(dev, ret);
+    return ret;
+  default:
+    return -ENOTSUP;
+  }
+}
+#endif
+
+#ifdef CONFIG_PCF8576_INIT_BACKGROUND
+static void _pcf8576_init_work(struct k_work *work) {
+  struct pcf8576_data *data =
+      CONTAINER_OF(work, struct pcf8576_data, init_work);
+  int ret;
+
+  k_sem_take(&data->tx_sem, K_FOREVER);
+  ret = _pcf8576_wake(data->dev);
+  k_sem_give(&data->tx_sem);
+  if (ret < 0) {
+    LOG_ERR("Failed to initialize %s, the next flush retries",
+            data->dev->name);
+  }
+}
+#endif
+
 static int pcf8576_initialize(const struct device *dev) {
   LOG_DBG("initializing...");
   const struct pcf8576_cfg *cfg = dev->config;
   struct pcf8576_data *data = dev->data;
 
+  k_sem_init(&data->tx_sem, 1, 1);
+  data->dev = dev;
+#ifdef CONFIG_PCF8576_STATS
+  stats_init(&data->stats.s_hdr, STATS_SIZE_32,
+             (sizeof(data->stats) - sizeof(struct stats_hdr)) / STATS_SIZE_32,
+             STATS_NAME_INIT_PARMS(pcf8576_stats));
+  if (stats_register(dev->name, &data->stats.s_hdr)) {
+    LOG_WRN("Failed to register statistics of %s", dev->name);
+  }
+#endif
+#ifdef CONFIG_PCF8576_FLUSH_COALESCE
+  k_work_init_delayable(&data->flush_work, _pcf8576_flush_work);
+#endif
+#ifdef CONFIG_PCF8576_IDLE_SUSPEND
+  k_work_init_delayable(&data->idle_work, _pcf8576_idle_work);
+#endif
+#if defined(CONFIG_PCF8576_WORKQ_DEDICATED)
+  if (!_pcf8576_workq_started) {
+    k_work_queue_start(&_pcf8576_workq, _pcf8576_workq_stack,
+                       K_KERNEL_STACK_SIZEOF(_pcf8576_workq_stack),
+                       CONFIG_PCF8576_WORKQ_PRIORITY, NULL);
+    _pcf8576_workq_started = true;
+  }
+#endif
+
   if (cfg->i2c.bus == NULL) {
     LOG_ERR("Failed to get pointer to %s device!", dev->name);
     return -EINVAL;
@@ -133,127 +1041,684 @@ static int pcf8576_initialize(const struct device *dev) {
     return -EINVAL;
   }
 
-  uint8_t mode = (DT_INST_PROP(0, powersave_mode) << 4) | 1 << 3 | // enable
-                 (DT_ENUM_IDX(DT_INST(0, nxp_pcf8576), lcd_bias) << 2) |
-                 (DT_INST_PROP(0, backplane_mux) & 0x03);
+  if (!device_is_ready(cfg->i2c.bus)) {
+    LOG_ERR("I2C bus %s is not ready!", cfg->i2c.bus->name);
+    return -ENODEV;
+  }
+
+  for (size_t word = 0; word < PCF8576_RAM_WORDS(cfg->ram_size); word++) {
+    atomic_set(&data->display_ram[word], 0);
+  }
+  data->bank_visible = 0;
+  data->blink = cfg->blink;
+  /* the chips are set up like after an idle power down: a single transaction
+   * carries the configuration and the cleared RAM */
+  data->power = PCF8576_POWER_IDLE;
+#if defined(CONFIG_PCF8576_INIT_BACKGROUND)
+  k_work_init(&data->init_work, _pcf8576_init_work);
+  k_work_submit_to_queue(PCF8576_WORKQ, &data->init_work);
+#elif defined(CONFIG_PCF8576_INIT_BLOCKING)
+  int ret;
 
-  uint8_t sub_address = (DT_INST_PROP(0, sub_address) & 0x07);
-  uint8_t buf[3];
-  buf[0] = PCF8576_CMD_CONTINUE | PCF8576_CMD_MODE_SET | mode;
-  buf[1] = PCF8576_CMD_CONTINUE | PCF8576_CMD_LOAD_DP;
-  buf[2] = PCF8576_CMD_LAST | PCF8576_CMD_DEVICE_SELECT | sub_address;
-  if (i2c_write_dt(&cfg->i2c, buf, 3) < 0) {
+  k_sem_take(&data->tx_sem, K_FOREVER);
+  ret = _pcf8576_wake(dev);
+  k_sem_give(&data->tx_sem);
+  if (ret < 0) {
     LOG_ERR("Failed to initialize device!");
     return -EIO;
   }
-
-  memset(data->display_ram, 0x0, sizeof(data->display_ram));
-  pcf8576_flush(dev);
+#endif
   LOG_DBG("initialization OK.");
   return 0;
 }
 
-static void _pcf8576_int_to_digits(uint32_t val,
-                                   uint8_t digits[],
-                                   size_t no_digits,
-                                   uint8_t space_digit,
-                                   bool sign) {
-  uint8_t sign_ch = sign ? DIGIT_NEG : space_digit;
-  int idx;
-  for(idx = no_digits-1; idx >= 0; idx--) {
-    digits[idx] = val%10;
-    val/=10;
-    if(val == 0) {
-      break ;
+int pcf8576_blink(const struct device *dev, enum pcf8576_blink_freq freq,
+                  enum pcf8576_blink_mode mode) {
+  const struct pcf8576_cfg *cfg = dev->config;
+  struct pcf8576_data *data = dev->data;
+  uint8_t blink = freq & 0x03;
+  int ret = 0;
+
+  if (mode == PCF8576_BLINK_ALT_BANK) {
+    /* the alternate bank only exists in 1:1 and 1:2 multiplex mode */
+    if (cfg->mux > 2) {
+      return -ENOTSUP;
     }
+    if (cfg->banked) {
+      return -EBUSY; /* both banks hold frames */
+    }
+    blink |= PCF8576_BLINK_AB;
+  }
+  /* a powered down device gets the setting when it is restored */
+  k_sem_take(&data->tx_sem, K_FOREVER);
+  if (data->power == PCF8576_POWER_ACTIVE) {
+    uint8_t *tail = PCF8576_TX_TAIL(data, cfg);
+
+    *tail = PCF8576_CMD_LAST | PCF8576_CMD_BLINK | blink;
+    ret = i2c_write_dt(&cfg->i2c, tail, 1);
+  }
+  if (ret) {
+    PCF8576_TRACE("lcd_i2c_error", -ret, cfg->i2c.addr);
+  }
+  if (ret == 0) {
+    data->blink = blink;
+  }
+  k_sem_give(&data->tx_sem);
+  return ret;
+}
+
+/* Lock-free read-modify-write of a RAM byte: the bits in clear are cleared,
+ * then the bits in set are set and the bits in flip are inverted. */
+static void _pcf8576_modify(const struct device *dev, size_t byte,
+                            uint8_t clear, uint8_t set, uint8_t flip) {
+  const struct pcf8576_cfg *cfg = dev->config;
+  struct pcf8576_data *data = dev->data;
+
+  if (byte >= cfg->ram_size) {
+    return; /* skipped, see lcd_submit() */
   }
-  if(--idx >=0) {
-    digits[idx--] = sign_ch;
-    for(; idx >= 0; idx--) {
-      digits[idx] = space_digit;
+  atomic_t *word = &data->display_ram[PCF8576_RAM_WORD(byte)];
+  unsigned int shift = PCF8576_RAM_SHIFT(byte);
+  unsigned long clear_bits = (unsigned long)clear << shift;
+  unsigned long set_bits = (unsigned long)set << shift;
+  unsigned long flip_bits = (unsigned long)flip << shift;
+  atomic_val_t old;
+  atomic_val_t new;
+
+  do {
+    old = atomic_get(word);
+    new = (atomic_val_t)((((unsigned long)old & ~clear_bits) | set_bits) ^
+                         flip_bits);
+    if (new == old) {
+      return;
     }
+  } while (!atomic_cas(word, old, new));
+
+  /* marked after the change, so a flush that has already collected the
+   * marks picks it up next time */
+  atomic_set_bit(data->dirty, byte);
+  if (cfg->banked) {
+    atomic_set_bit(_pcf8576_dirty(dev, 1), byte);
   }
 }
 
-void _pcf8576_num_ovf(uint8_t digits[], size_t no_digits) {
-  for(int idx = 0; idx < no_digits; idx++) {
-    digits[idx] = DIGIT_NEG;
+void _pcf8576_update(const struct device *dev, size_t byte, uint8_t clear,
+                     uint8_t set) {
+  _pcf8576_modify(dev, byte, clear, set, 0);
+}
+
+void _pcf8576_set(const struct device *dev, const pcf8576_seg_t seg) {
+  _pcf8576_update(dev, PCF8576_SEG_BYTE_OF(seg), 0, PCF8576_SEG_MASK_OF(seg));
+}
+
+void _pcf8576_clear(const struct device *dev, const pcf8576_seg_t seg) {
+  _pcf8576_update(dev, PCF8576_SEG_BYTE_OF(seg), PCF8576_SEG_MASK_OF(seg), 0);
+}
+
+void _pcf8576_sign(const struct device *dev, const pcf8576_seg_t seg,
+                   bool state) {
+  _pcf8576_stats_render(dev);
+  _pcf8576_trace_render_start(PCF8576_TRACE_SIGN, seg);
+  if (state) {
+    _pcf8576_set(dev, seg);
+  } else {
+    _pcf8576_clear(dev, seg);
   }
+  _pcf8576_trace_render_end(PCF8576_TRACE_SIGN, seg);
 }
 
-void _pcf8576_float_to_digits(float val, uint8_t digits[], size_t no_digits){
+void _pcf8576_sign_toggle(const struct device *dev, const pcf8576_seg_t seg) {
+  _pcf8576_stats_render(dev);
+  _pcf8576_trace_render_start(PCF8576_TRACE_SIGN, seg);
+  _pcf8576_modify(dev, PCF8576_SEG_BYTE_OF(seg), 0, 0,
+                  PCF8576_SEG_MASK_OF(seg));
+  _pcf8576_trace_render_end(PCF8576_TRACE_SIGN, seg);
+}
 
-  bool sign = val < 0;
-  uint32_t intpart = sign ? (uint32_t)(val*-1) : (uint32_t)val;
-  size_t int_digits = _pcf8576_count_int_digits(intpart);
-  int_digits += sign ? 1 : 0;
+bool _pcf8576_num_changed(const struct device *dev,
+                          struct pcf8576_num_memo *memo, uint32_t value,
+                          uint8_t decimals, uint8_t flags) {
+  if (memo->dev == dev && memo->value == value &&
+      memo->decimals == decimals && memo->flags == flags) {
+    return false;
+  }
+  /* memo->dev is only updated once the digits are shown */
+  memo->value = value;
+  memo->decimals = decimals;
+  memo->flags = flags;
+  return true;
+}
+
+void _pcf8576_num_show(const struct device *dev, const nums_t map[],
+                       uint8_t shown[], const uint8_t digits[],
+                       size_t no_digits, struct pcf8576_num_memo *memo) {
+  bool known = memo->dev == dev;
 
-  if(int_digits > no_digits) {
-    _pcf8576_num_ovf(digits, no_digits);
-  }else {
-    uint32_t fracpart;
-    size_t frac_digits = _pcf8576_count_frac_digits(val,no_digits-int_digits, &fracpart);
-    if((frac_digits > 0) && (int_digits < no_digits)) {
-      size_t dp_pos = no_digits - frac_digits;
-      _pcf8576_int_to_digits(intpart, digits, dp_pos, DIGIT_BLANK,sign);
-      _pcf8576_int_to_digits(fracpart, &digits[dp_pos], frac_digits,0, false);
-      digits[dp_pos-1] += DIGIT_DP;
-    }else {
-      _pcf8576_int_to_digits(intpart, digits, no_digits,DIGIT_BLANK,sign);
+  for (size_t idx = 0; idx < no_digits; idx++) {
+    if (!known || shown[idx] != digits[idx]) {
+      _pcf8576_set_digit(dev, &map[idx], digits[idx]);
+      shown[idx] = digits[idx];
     }
   }
+  memo->dev = dev;
 }
 
-static void _pcf8576_set(const struct device *dev, const uint8_t data[2]) {
-  ((struct pcf8576_data *)dev->data)->display_ram[data[1]] |= data[0];
+#ifdef CONFIG_PCF8576_COMPACT_DESCRIPTORS
+int _pcf8576_bar_render(const struct device *dev, const pcf8576_seg_t segs[],
+                        size_t count, int level,
+                        struct pcf8576_bar_memo *memo) {
+  size_t from = 0;
+  size_t to = count;
+
+  if (level < 0 || level > count) {
+    return -EINVAL;
+  }
+  _pcf8576_stats_render(dev);
+  _pcf8576_trace_render_start(PCF8576_TRACE_BAR, memo);
+  if (memo->dev == dev) {
+    from = MIN(level, memo->level);
+    to = MAX(level, memo->level);
+  }
+  for (size_t idx = from; idx < to; idx++) {
+    if (idx < level) {
+      _pcf8576_set(dev, segs[idx]);
+    } else {
+      _pcf8576_clear(dev, segs[idx]);
+    }
+  }
+  memo->dev = dev;
+  memo->level = level;
+  _pcf8576_trace_render_end(PCF8576_TRACE_BAR, memo);
+  return 0;
 }
+#else
+int _pcf8576_bar_render(const struct device *dev,
+                        const struct pcf8576_bar_map *bar, int level,
+                        struct pcf8576_bar_memo *memo) {
+  const uint8_t *on;
+  const uint8_t *was = NULL;
 
-static void _pcf8576_clear(const struct device *dev, const uint8_t data[2]) {
-  ((struct pcf8576_data *)dev->data)->display_ram[data[1]] &= ~data[0];
+  if (level < 0 || level > bar->count) {
+    return -EINVAL;
+  }
+  _pcf8576_stats_render(dev);
+  _pcf8576_trace_render_start(PCF8576_TRACE_BAR, memo);
+  if (memo->dev == dev) {
+    if (memo->level == level) {
+      _pcf8576_trace_render_end(PCF8576_TRACE_BAR, memo);
+      return 0;
+    }
+    was = &bar->level[memo->level * bar->count];
+  }
+  on = &bar->level[level * bar->count];
+  for (size_t slot = 0; slot < bar->count; slot++) {
+    if (bar->mask[slot] == 0 || (was != NULL && was[slot] == on[slot])) {
+      continue;
+    }
+    _pcf8576_update(dev, bar->byte[slot], bar->mask[slot], on[slot]);
+  }
+  memo->dev = dev;
+  memo->level = level;
+  _pcf8576_trace_render_end(PCF8576_TRACE_BAR, memo);
+  return 0;
 }
+#endif
 
-static size_t _pcf8576_count_int_digits(uint32_t number) {
-  size_t cnt =  (number >= 1000000000) ? 10
-        : (number >= 100000000) ? 9
-        : (number >= 10000000) ? 8
-        : (number >= 1000000) ? 7
-        : (number >= 100000) ? 6
-        : (number >= 10000) ? 5
-        : (number >= 1000) ? 4
-        : (number >= 100) ? 3
-        : (number >= 10) ? 2
-        : 1;
-  return cnt;
+void pcf8576_batch_init(struct pcf8576_batch *batch,
+                        struct lcd_segment_update *updates, size_t size) {
+  batch->updates = updates;
+  batch->size = size;
+  batch->count = 0;
+  batch->overflow = false;
 }
 
-static size_t _pcf8576_count_frac_digits(float val, size_t max_d, uint32_t *fr) {
-  if(val < 0) {
-    val *= -1.0;
+/* appends a masked write, merged into an earlier write of the same byte */
+static void _pcf8576_batch_add(struct pcf8576_batch *batch, size_t byte,
+                               uint8_t clear, uint8_t set) {
+  struct lcd_segment_update *upd;
+
+  if ((clear | set) == 0) {
+    return; /* segment not connected */
+  }
+  for (size_t idx = 0; idx < batch->count; idx++) {
+    upd = &batch->updates[idx];
+    if (upd->offset == byte) {
+      upd->clear |= clear;
+      upd->set = (upd->set & ~clear) | set;
+      return;
+    }
+  }
+  if (batch->count == batch->size) {
+    batch->overflow = true;
+    return;
   }
-  float fr_float = (val - (uint32_t)val);
-  size_t ret = max_d;
-  uint32_t fracpart = (uint32_t)(fr_float * _pcf8576_p10[max_d]+0.5);
-  if(fracpart != 0) {
-    while(fracpart % 10 == 0 && ret) {
-      fracpart/=10;
-      ret--;
+  upd = &batch->updates[batch->count++];
+  upd->offset = byte;
+  upd->clear = clear;
+  upd->set = set;
+}
+
+void _pcf8576_batch_sign(struct pcf8576_batch *batch, const pcf8576_seg_t seg,
+                         bool state) {
+  uint8_t mask = PCF8576_SEG_MASK_OF(seg);
+
+  _pcf8576_batch_add(batch, PCF8576_SEG_BYTE_OF(seg), mask, state ? mask : 0);
+}
+
+void _pcf8576_batch_digits(struct pcf8576_batch *batch, const nums_t map[],
+                           const uint8_t digits[], size_t no_digits) {
+  struct pcf8576_write writes[PCF8576_DIGIT_MAX_WRITES];
+
+  for (size_t digit = 0; digit < no_digits; digit++) {
+    size_t count = _pcf8576_digit_writes(&map[digit], digits[digit], writes);
+
+    for (size_t idx = 0; idx < count; idx++) {
+      _pcf8576_batch_add(batch, writes[idx].byte, writes[idx].clear,
+                         writes[idx].set);
     }
-  }else {
-    ret = 0;
   }
-  *fr = fracpart;
+}
+
+#ifdef CONFIG_PCF8576_COMPACT_DESCRIPTORS
+int _pcf8576_batch_bar(struct pcf8576_batch *batch, const pcf8576_seg_t segs[],
+                       size_t count, int level) {
+  if (level < 0 || level > count) {
+    return -EINVAL;
+  }
+  for (size_t idx = 0; idx < count; idx++) {
+    _pcf8576_batch_sign(batch, segs[idx], idx < level);
+  }
+  return 0;
+}
+#else
+int _pcf8576_batch_bar(struct pcf8576_batch *batch,
+                       const struct pcf8576_bar_map *bar, int level) {
+  const uint8_t *on;
+
+  if (level < 0 || level > bar->count) {
+    return -EINVAL;
+  }
+  on = &bar->level[level * bar->count];
+  for (size_t slot = 0; slot < bar->count; slot++) {
+    _pcf8576_batch_add(batch, bar->byte[slot], bar->mask[slot], on[slot]);
+  }
+  return 0;
+}
+#endif
+
+int pcf8576_batch_submit(const struct device *dev, struct pcf8576_batch *batch,
+                         uint32_t flags) {
+  int ret = -ENOMEM;
+
+  if (!batch->overflow) {
+    ret = lcd_submit(dev, batch->updates, batch->count, flags);
+  }
+  batch->count = 0;
+  batch->overflow = false;
   return ret;
 }
 
-static const struct lcd_driver_api pcf8576_lcds_api = {.flush = pcf8576_flush};
+#ifdef CONFIG_PCF8576_MARQUEE
+static void _pcf8576_marquee_work(struct k_work *work) {
+  struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+  struct pcf8576_marquee *mq =
+      CONTAINER_OF(dwork, struct pcf8576_marquee, work);
+  bool known = mq->memo->dev == mq->dev;
+
+  _pcf8576_stats_render(mq->dev);
+  for (size_t idx = 0; idx < mq->width; idx++) {
+    int src = mq->pos + (int)idx;
+    uint8_t code = src >= 0 && src < (int)mq->len ? mq->buf[src] : DIGIT_BLANK;
+
+    if (!known || mq->shown[idx] != code) {
+      _pcf8576_set_digit(mq->dev, &mq->map[idx], code);
+      mq->shown[idx] = code;
+    }
+  }
+  /* the next pcf8576_num call on the widget starts from this window */
+  mq->memo->dev = mq->dev;
+  mq->memo->decimals = PCF8576_NUM_MEMO_NONE;
+  (void)pcf8576_flush(mq->dev);
+
+  if (mq->pos < mq->last) {
+    mq->pos += mq->step;
+  } else if (mq->loop) {
+    mq->pos = mq->first;
+  } else {
+    return;
+  }
+  k_work_schedule_for_queue(PCF8576_WORKQ, &mq->work, K_MSEC(mq->period_ms));
+}
+
+void _pcf8576_marquee_init(struct pcf8576_marquee *mq,
+                           const struct device *dev, const nums_t map[],
+                           uint8_t shown[], struct pcf8576_num_memo *memo,
+                           size_t width) {
+  *mq = (struct pcf8576_marquee){
+      .dev = dev, .map = map, .shown = shown, .memo = memo, .width = width};
+  k_work_init_delayable(&mq->work, _pcf8576_marquee_work);
+}
+
+/* convert a text to digit codes, returns the number of digits */
+static int _pcf8576_marquee_parse(const char *text, uint8_t codes[],
+                                  size_t size) {
+  size_t len = 0;
+
+  for (; *text != '\0'; text++) {
+    if (*text == '.' || *text == ',') {
+      /* the decimal point is shown on the digit before it */
+      if (len == 0 || codes[len - 1] >= DIGIT_NEG) {
+        return -EINVAL;
+      }
+      codes[len - 1] += DIGIT_DP;
+      continue;
+    }
+    if (len == size) {
+      return -ENOMEM;
+    }
+    if (*text >= '0' && *text <= '9') {
+      codes[len] = *text - '0';
+    } else if (*text == '-') {
+      codes[len] = DIGIT_NEG;
+    } else if (*text == ' ') {
+      codes[len] = DIGIT_BLANK;
+    } else {
+      return -EINVAL;
+    }
+    len++;
+  }
+  return len;
+}
+
+static void _pcf8576_marquee_start(struct pcf8576_marquee *mq, size_t len,
+                                   size_t step, int first, int last,
+                                   uint32_t period_ms, bool loop) {
+  mq->len = len;
+  mq->step = step;
+  mq->first = first;
+  mq->last = last;
+  mq->pos = first;
+  mq->period_ms = period_ms;
+  mq->loop = loop;
+  k_work_schedule_for_queue(PCF8576_WORKQ, &mq->work, K_NO_WAIT);
+}
+
+int pcf8576_marquee_text(struct pcf8576_marquee *mq, const char *text,
+                         uint32_t period_ms, bool loop) {
+  int len;
+
+  if (period_ms == 0) {
+    return -EINVAL;
+  }
+  pcf8576_marquee_stop(mq);
+  len = _pcf8576_marquee_parse(text, mq->buf, sizeof(mq->buf));
+  if (len <= 0) {
+    return len < 0 ? len : -EINVAL;
+  }
+  /* enters at the right edge, the last window shows the last digit on the
+   * leftmost position */
+  _pcf8576_marquee_start(mq, len, 1, 1 - (int)mq->width, len - 1, period_ms,
+                         loop);
+  return 0;
+}
+
+int pcf8576_marquee_frames(struct pcf8576_marquee *mq,
+                           const char *const frames[], size_t count,
+                           uint32_t period_ms, bool loop) {
+  size_t off = 0;
+
+  if (period_ms == 0 || count == 0) {
+    return -EINVAL;
+  }
+  pcf8576_marquee_stop(mq);
+  for (size_t frame = 0; frame < count; frame++, off += mq->width) {
+    if (off + mq->width > sizeof(mq->buf)) {
+      return -ENOMEM;
+    }
+    uint8_t *codes = &mq->buf[off];
+    int len = _pcf8576_marquee_parse(frames[frame], codes, mq->width);
+
+    if (len < 0) {
+      return -EINVAL;
+    }
+    memmove(&codes[mq->width - len], codes, len);
+    memset(codes, DIGIT_BLANK, mq->width - len);
+  }
+  _pcf8576_marquee_start(mq, off, mq->width, 0, off - mq->width, period_ms,
+                         loop);
+  return 0;
+}
+
+void pcf8576_marquee_stop(struct pcf8576_marquee *mq) {
+  struct k_work_sync sync;
+
+  (void)k_work_cancel_delayable_sync(&mq->work, &sync);
+}
+#endif
+
+#ifdef CONFIG_PCF8576_TRACING
+#ifdef CONFIG_TRACING_USER
+void __weak pcf8576_trace_user(const char *name, uint32_t arg0,
+                               uint32_t arg1) {
+  ARG_UNUSED(name);
+  ARG_UNUSED(arg0);
+  ARG_UNUSED(arg1);
+}
+#endif
+
+void _pcf8576_trace_render_start(enum pcf8576_trace_widget kind,
+                                 const void *widget) {
+  PCF8576_TRACE("lcd_render_start", kind, (uintptr_t)widget);
+}
+
+void _pcf8576_trace_render_end(enum pcf8576_trace_widget kind,
+                               const void *widget) {
+  PCF8576_TRACE("lcd_render_end", kind, (uintptr_t)widget);
+}
+#endif
+
+#ifdef CONFIG_PCF8576_STATS
+void _pcf8576_stats_render(const struct device *dev) {
+  struct pcf8576_data *data = dev->data;
+
+  PCF8576_STATS_INC(data, renders);
+}
+#endif
+
+/* the RAM mirror holds the RAM bytes in order within little endian words */
+static void *pcf8576_get_framebuffer(const struct device *dev) {
+  struct pcf8576_data *data = dev->data;
+
+  if (IS_ENABLED(CONFIG_BIG_ENDIAN)) {
+    return NULL;
+  }
+  return data->display_ram;
+}
+
+static int pcf8576_write_segments(const struct device *dev,
+                                  const uint8_t *buf, size_t offset,
+                                  size_t len) {
+  const struct pcf8576_cfg *cfg = dev->config;
+  struct pcf8576_data *data = dev->data;
+  const uint8_t *fb = pcf8576_get_framebuffer(dev);
+
+  if (offset > cfg->ram_size || len > cfg->ram_size - offset) {
+    return -EINVAL;
+  }
+  for (size_t byte = offset; byte < offset + len; byte++) {
+    if (fb != NULL && buf == fb + offset) {
+      /* rendered in place, only the marks are missing */
+      atomic_set_bit(data->dirty, byte);
+      if (cfg->banked) {
+        atomic_set_bit(_pcf8576_dirty(dev, 1), byte);
+      }
+    } else {
+      _pcf8576_modify(dev, byte, 0xff, buf[byte - offset], 0);
+    }
+  }
+  return 0;
+}
+
+static void pcf8576_capabilities(const struct device *dev,
+                                 struct lcd_capabilities *caps) {
+  const struct pcf8576_cfg *cfg = dev->config;
+
+  caps->ram_size = cfg->ram_size;
+  caps->segments = cfg->ram_size / cfg->dev_bytes * PCF8576_COLUMNS;
+  caps->backplanes = cfg->mux;
+  caps->flags = LCD_CAP_BLINK;
+  if (cfg->banked) {
+    caps->flags |= LCD_CAP_BANKED;
+  }
+  if (!IS_ENABLED(CONFIG_BIG_ENDIAN)) {
+    caps->flags |= LCD_CAP_FRAMEBUFFER;
+  }
+}
+
+/* applied within a frame, so that a concurrent flush does not show half of
+ * the updates */
+static int pcf8576_submit(const struct device *dev,
+                          const struct lcd_segment_update *updates,
+                          size_t count) {
+  pcf8576_frame_begin(dev);
+  for (size_t idx = 0; idx < count; idx++) {
+    struct lcd_segment_update upd = updates[idx];
+
+    _pcf8576_update(dev, upd.offset, upd.clear, upd.set);
+  }
+  return pcf8576_frame_commit(dev);
+}
+
+static const struct lcd_driver_api pcf8576_lcds_api = {
+    .flush = pcf8576_flush,
+    .write_segments = pcf8576_write_segments,
+    .get_framebuffer = pcf8576_get_framebuffer,
+    .capabilities = pcf8576_capabilities,
+    .submit = pcf8576_submit,
+};
+
+#define PCF8576_INST_DEV_BYTES(id)                                             \
+  PCF8576_DEV_BYTES(DT_INST_PROP(id, backplane_mux))
+
+#define PCF8576_INST_RAM_SIZE(id)                                              \
+  (PCF8576_INST_DEV_BYTES(id) * DT_INST_PROP(id, cascade_devices))
+
+#define PCF8576_INST_MODE(id)                                                  \
+  ((DT_INST_PROP(id, powersave_mode) << 4) |                                   \
+   (DT_INST_ENUM_IDX(id, lcd_bias) << 2) |                                     \
+   (DT_INST_PROP(id, backplane_mux) & 0x03))
+
+#define PCF8576_INST_BLINK(id)                                                 \
+  ((DT_INST_PROP(id, blink_alternate_bank) ? PCF8576_BLINK_AB : 0) |           \
+   DT_INST_ENUM_IDX(id, blink_frequency))
+
+#define PCF8576_INST_BANKS(id) (DT_INST_PROP(id, bank_buffered) ? 2 : 1)
+
+#define PCF8576_INST_ALT_BANK(id)                                              \
+  (!DT_INST_PROP(id, bank_buffered) && DT_INST_PROP(id, backplane_mux) <= 2)
 
 #define PCF8576_INSTANTIATE(id)                                                \
+  BUILD_ASSERT(!DT_INST_PROP(id, blink_alternate_bank) ||                      \
+                   DT_INST_PROP(id, backplane_mux) <= 2,                       \
+               "alternate RAM bank blinking needs 1:1 or 1:2 multiplexing");   \
+  BUILD_ASSERT(!DT_INST_PROP(id, bank_buffered) ||                             \
+                   DT_INST_PROP(id, backplane_mux) <= 2,                       \
+               "bank buffering needs 1:1 or 1:2 multiplexing");                \
+  BUILD_ASSERT(!DT_INST_PROP(id, bank_buffered) ||                             \
+                   !DT_INST_PROP(id, blink_alternate_bank),                    \
+               "bank buffering and alternate bank blinking exclude each "      \
+               "other");                                                       \
+  BUILD_ASSERT(COND_CODE_1(DT_INST_NODE_HAS_PROP(id, lcd),                     \
+                           (PCF8576_LCD_MUX(DT_INST_PHANDLE(id, lcd)) ==       \
+                            DT_INST_PROP(id, backplane_mux)),                  \
+                           (1)),                                               \
+               "display driven by more than one PCF8576 node");                \
+  BUILD_ASSERT(!IS_ENABLED(CONFIG_PCF8576_COMPACT_DESCRIPTORS) ||              \
+                   PCF8576_INST_RAM_SIZE(id) * 8 <= PCF8576_SEG_NONE,          \
+               "display RAM too large for compact segment descriptors");       \
+  BUILD_ASSERT(DT_INST_PROP(id, cascade_devices) >= 1 &&                       \
+                   DT_INST_PROP(id, sub_address) +                             \
+                           DT_INST_PROP(id, cascade_devices) <=                \
+                       PCF8576_MAX_DEVICES,                                    \
+               "cascaded PCF8576 sub-addresses out of range");                 \
+  static atomic_t                                                              \
+      pcf8576_##id##_ram[PCF8576_RAM_WORDS(PCF8576_INST_RAM_SIZE(id))];        \
+  static uint8_t pcf8576_##id##_tx_frame[PCF8576_TX_FRAME_SIZE(               \
+      PCF8576_INST_RAM_SIZE(id), PCF8576_INST_ALT_BANK(id))]                   \
+      PCF8576_TX_SECTION __aligned(CONFIG_PCF8576_TX_ALIGN);                   \
+  static atomic_t pcf8576_##id##_dirty                                         \
+      [ATOMIC_BITMAP_SIZE(PCF8576_INST_RAM_SIZE(id)) * PCF8576_INST_BANKS(id)];  \
   static const struct pcf8576_cfg pcf8576_##id##_cfg = {                       \
-      .i2c = I2C_DT_SPEC_INST_GET(id)};                                        \
-  static struct pcf8576_data pcf8576_##id##_data;                              \
-  DEVICE_DT_INST_DEFINE(id, &pcf8576_initialize, NULL, &pcf8576_##id##_data,   \
+      .i2c = I2C_DT_SPEC_INST_GET(id),                                         \
+      .mode = PCF8576_INST_MODE(id),                                           \
+      .mux = DT_INST_PROP(id, backplane_mux),                                  \
+      .blink = PCF8576_INST_BLINK(id),                                         \
+      .sub_address = DT_INST_PROP(id, sub_address),                            \
+      .dev_bytes = PCF8576_INST_DEV_BYTES(id),                                 \
+      .ram_size = PCF8576_INST_RAM_SIZE(id),                                   \
+      .banked = DT_INST_PROP(id, bank_buffered),                               \
+      .alt_bank = PCF8576_INST_ALT_BANK(id)};                                  \
+  static struct pcf8576_data pcf8576_##id##_data = {                           \
+      .display_ram = pcf8576_##id##_ram,                                       \
+      .dirty = pcf8576_##id##_dirty,                                           \
+      .tx_frame = pcf8576_##id##_tx_frame};                                    \
+  PM_DEVICE_DT_INST_DEFINE(id, pcf8576_pm_action);                             \
+  DEVICE_DT_INST_DEFINE(id, &pcf8576_initialize, PM_DEVICE_DT_INST_GET(id),    \
+                        &pcf8576_##id##_data,                                  \
                         &pcf8576_##id##_cfg, APPLICATION,                      \
-                        CONFIG_LCD_INIT_PRIORITY, &pcf8576_lcds_api)
+                        CONFIG_LCD_INIT_PRIORITY, &pcf8576_lcds_api);
+
+DT_INST_FOREACH_STATUS_OKAY(PCF8576_INSTANTIATE) // @suppress("Unused variable
+                                                 // declaration in file scope")
+
+#ifdef CONFIG_PCF8576_STATS_SHELL
+#define PCF8576_DEV_GET(id) DEVICE_DT_INST_GET(id),
+
+static const struct device *const _pcf8576_devs[] = {
+    DT_INST_FOREACH_STATUS_OKAY(PCF8576_DEV_GET)};
+
+static const char *const _pcf8576_lat_names[PCF8576_LAT_BUCKETS] = {
+    "<128us", "<256us", "<512us", "<1ms", "<2ms", "<4ms", "<8ms", ">=8ms"};
+
+static void _pcf8576_stats_print(const struct shell *sh,
+                                 const struct device *dev) {
+  struct pcf8576_data *data = dev->data;
+
+  shell_print(sh, "%s: flushes %u bytes %u errors %u skipped %u renders %u",
+              dev->name, data->stats.flushes, data->stats.bytes,
+              data->stats.errors, data->stats.skipped, data->stats.renders);
+  for (size_t bucket = 0; bucket < PCF8576_LAT_BUCKETS; bucket++) {
+    shell_print(sh, "  %-6s %u", _pcf8576_lat_names[bucket],
+                *_pcf8576_lat_entry(data, bucket));
+  }
+}
+
+static int _pcf8576_cmd_stats(const struct shell *sh, size_t argc,
+                              char **argv) {
+  bool found = false;
+
+  for (size_t idx = 0; idx < ARRAY_SIZE(_pcf8576_devs); idx++) {
+    const struct device *dev = _pcf8576_devs[idx];
+
+    if (argc > 1 && strcmp(argv[1], dev->name) != 0) {
+      continue;
+    }
+    _pcf8576_stats_print(sh, dev);
+    found = true;
+  }
+  if (!found) {
+    shell_error(sh, "No PCF8576 device %s", argc > 1 ? argv[1] : "");
+    return -ENODEV;
+  }
+  return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(
+    _pcf8576_lcd_cmds,
+    SHELL_CMD_ARG(stats, NULL,
+                  "Show flush statistics and latency histogram [device]",
+                  _pcf8576_cmd_stats, 1, 1),
+    SHELL_SUBCMD_SET_END);
 
-DT_INST_FOREACH_STATUS_OKAY(PCF8576_INSTANTIATE); // @suppress("Unused variable
-                                                  // declaration in file scope")
+SHELL_CMD_REGISTER(lcd, &_pcf8576_lcd_cmds, "LCD commands", NULL);
+#endif
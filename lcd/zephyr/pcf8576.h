@@ -8,126 +8,726 @@
 #define ZEPHYR_INCLUDE_DISPLAY_PCF8576_H_
 
 #include <zephyr/device.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
 #include <zephyr/types.h>
 
+#include "lcd.h"
+#include "pcf8576_core.h"
+
 #define PCF8576_NAME "PCF8576"
 
-typedef uint8_t nums_t[8][2];
+/* multiplex mode of the PCF8576 driving the lcd node, 4 if none refers to it.
+ * A display shall be driven by a single device node. */
+#define _PCF8576_INST_MUX(inst, node)                                          \
+  COND_CODE_1(DT_NODE_HAS_PROP(inst, lcd),                                     \
+              (+(DT_SAME_NODE(DT_PHANDLE(inst, lcd), node)                     \
+                     ? DT_PROP(inst, backplane_mux)                            \
+                     : 0)),                                                    \
+              ())
+#define _PCF8576_LCD_MUX_SUM(node)                                             \
+  (0 DT_FOREACH_STATUS_OKAY_VARGS(nxp_pcf8576, _PCF8576_INST_MUX, node))
+#define PCF8576_LCD_MUX(node)                                                  \
+  (_PCF8576_LCD_MUX_SUM(node) ? _PCF8576_LCD_MUX_SUM(node) : 4)
+
+/* RAM bit mask and RAM byte of a segment node of the display */
+#define _PCF8576_SEG_NODE_MUX(seg) PCF8576_LCD_MUX(DT_PARENT(seg))
+#define PCF8576_SEG_NODE_MASK(seg)                                             \
+  PCF8576_SEG_MASK_MUX(_PCF8576_SEG_NODE_MUX(seg),                             \
+                       DT_PROP_BY_IDX(seg, segment, 0),                        \
+                       DT_PROP_BY_IDX(seg, segment, 1))
+#define PCF8576_SEG_NODE_BYTE(seg)                                             \
+  PCF8576_SEG_BYTE_MUX(_PCF8576_SEG_NODE_MUX(seg),                             \
+                       DT_PROP_BY_IDX(seg, segment, 0),                        \
+                       DT_PROP_BY_IDX(seg, segment, 1))
+#define SEG_NODE2SHIFT(seg)                                                    \
+  { PCF8576_SEG_NODE_MASK(seg), PCF8576_SEG_NODE_BYTE(seg) }
+
+#define PCF8576_SEG_NODE_INDEX(seg)                                            \
+  PCF8576_SEG_INDEX_MUX(_PCF8576_SEG_NODE_MUX(seg),                            \
+                        DT_PROP_BY_IDX(seg, segment, 0),                       \
+                        DT_PROP_BY_IDX(seg, segment, 1))
 
-#define SEG2SHIFT(x, y)                                                        \
-  { (1 << (7 - ((x) + (((y)&0x01) << 2)))), (y) >> 1 }
+/* segment descriptor used by the widget tables: the RAM bit index with
+ * CONFIG_PCF8576_COMPACT_DESCRIPTORS, otherwise RAM bit mask and RAM byte */
+#ifdef CONFIG_PCF8576_COMPACT_DESCRIPTORS
+#define PCF8576_SEG_DESC(seg) { PCF8576_SEG_NODE_INDEX(seg) }
+#else
+#define PCF8576_SEG_DESC(seg) SEG_NODE2SHIFT(seg)
+#endif
 
 #define pcf8576_sign(dev, label, state)                                        \
   do {                                                                         \
-    const uint8_t tmp_seg[] = SEG2SHIFT(                                       \
-        DT_PROP_BY_IDX(DT_PHANDLE(DT_NODELABEL(label), sign), segment, 0),     \
-        DT_PROP_BY_IDX(DT_PHANDLE(DT_NODELABEL(label), sign), segment, 1));    \
-    if (state) {                                                               \
-      _pcf8576_set(dev, tmp_seg);                                              \
-    } else {                                                                   \
-      _pcf8576_clear(dev, tmp_seg);                                            \
-    }                                                                          \
+    static const pcf8576_seg_t tmp_seg =                                       \
+        PCF8576_SEG_DESC(DT_PHANDLE(DT_NODELABEL(label), sign));               \
+    _pcf8576_sign(dev, tmp_seg, state);                                        \
   } while (0)
 
-#define _BAR_CFG(item)                                                         \
-  SEG2SHIFT(DT_PROP_BY_IDX(DT_PHANDLE(item, bar), segment, 0),                 \
-            DT_PROP_BY_IDX(DT_PHANDLE(item, bar), segment, 1)),
+/* inverts a sign; like the other sign and bar operations it is atomic and
+ * may be used from ISRs */
+#define pcf8576_sign_toggle(dev, label)                                        \
+  do {                                                                         \
+    static const pcf8576_seg_t tmp_seg =                                       \
+        PCF8576_SEG_DESC(DT_PHANDLE(DT_NODELABEL(label), sign));               \
+    _pcf8576_sign_toggle(dev, tmp_seg);                                        \
+  } while (0)
+
+#define _PCF8576_COUNT_CHILD(item) +1
+/* number of child nodes of a widget, i.e. digits of a number or segments of a
+ * bar, usable in declarations of other translation units */
+#define PCF8576_WIDGET_SIZE(label)                                             \
+  (0 DT_FOREACH_CHILD(DT_NODELABEL(label), _PCF8576_COUNT_CHILD))
+
+#ifdef CONFIG_PCF8576_COMPACT_DESCRIPTORS
+#define _BAR_CFG(item) PCF8576_SEG_DESC(DT_PHANDLE(item, bar)),
+
+#define pcf8576_bar_define(label)                                              \
+  const pcf8576_seg_t bararray_##label[] = {                                   \
+      DT_FOREACH_CHILD(DT_NODELABEL(label), _BAR_CFG)};                        \
+  struct pcf8576_bar_memo barmemo_##label;
+
+#define pcf8576_bar_declare(label)                                             \
+  extern const pcf8576_seg_t bararray_##label[PCF8576_WIDGET_SIZE(label)];     \
+  extern struct pcf8576_bar_memo barmemo_##label;
+#else
+/**
+ * @brief Precomputed RAM masks of a bar graph.
+ *
+ * Slot i describes the RAM byte of segment i of the bar; slots whose byte is
+ * also covered by a later slot, or whose segment is not connected, have an
+ * all-zero mask and are skipped. level holds count slots for each level
+ * 0..count, the segments of the bar to turn on within the slot's byte.
+ */
+struct pcf8576_bar_map {
+  const uint8_t *byte;  /* RAM byte of the slot */
+  const uint8_t *mask;  /* all segments of the bar within that byte */
+  const uint8_t *level; /* [count + 1][count] segments on at each level */
+  uint8_t count;
+};
+
+/* longest bar the level table can be generated for */
+#define PCF8576_BAR_MAX_SEGMENTS 16
+
+#define _BAR_NARG(...)                                                         \
+  _BAR_NARG_(__VA_ARGS__, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1)
+#define _BAR_NARG_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13,     \
+                   _14, _15, _16, n, ...)                                      \
+  n
+#define _BAR_CAT(a, b) _BAR_CAT_(a, b)
+#define _BAR_CAT_(a, b) a##b
+#define _BAR_HEAD(a, ...) a
+#define _BAR_LIST(...) __VA_ARGS__
+
+#define _BAR_SEG(item) DT_PHANDLE(item, bar)
+#define _BAR_ARG(item) , _BAR_SEG(item)
+#define _BAR_BYTE(item)                                                        \
+  (DT_PROP_BY_IDX(_BAR_SEG(item), segment, 1) <                                \
+           PCF8576_COLUMNS * PCF8576_MAX_DEVICES                               \
+       ? PCF8576_SEG_NODE_BYTE(_BAR_SEG(item))                                 \
+       : 0),
+/* segment n lives in the RAM byte of segment s */
+#define _BAR_SAME(s, n)                                                        \
+  (PCF8576_SEG_NODE_MASK(n) != 0 &&                                            \
+   PCF8576_SEG_NODE_BYTE(n) == PCF8576_SEG_NODE_BYTE(s))
+#define _BAR_TERM(n, s) (_BAR_SAME(s, n) ? PCF8576_SEG_NODE_MASK(n) : 0)
+#define _BAR_ON_1(s, a) _BAR_TERM(a, s)
+#define _BAR_ON_2(s, a, ...) _BAR_TERM(a, s) | _BAR_ON_1(s, __VA_ARGS__)
+#define _BAR_ON_3(s, a, ...) _BAR_TERM(a, s) | _BAR_ON_2(s, __VA_ARGS__)
+#define _BAR_ON_4(s, a, ...) _BAR_TERM(a, s) | _BAR_ON_3(s, __VA_ARGS__)
+#define _BAR_ON_5(s, a, ...) _BAR_TERM(a, s) | _BAR_ON_4(s, __VA_ARGS__)
+#define _BAR_ON_6(s, a, ...) _BAR_TERM(a, s) | _BAR_ON_5(s, __VA_ARGS__)
+#define _BAR_ON_7(s, a, ...) _BAR_TERM(a, s) | _BAR_ON_6(s, __VA_ARGS__)
+#define _BAR_ON_8(s, a, ...) _BAR_TERM(a, s) | _BAR_ON_7(s, __VA_ARGS__)
+#define _BAR_ON_9(s, a, ...) _BAR_TERM(a, s) | _BAR_ON_8(s, __VA_ARGS__)
+#define _BAR_ON_10(s, a, ...) _BAR_TERM(a, s) | _BAR_ON_9(s, __VA_ARGS__)
+#define _BAR_ON_11(s, a, ...) _BAR_TERM(a, s) | _BAR_ON_10(s, __VA_ARGS__)
+#define _BAR_ON_12(s, a, ...) _BAR_TERM(a, s) | _BAR_ON_11(s, __VA_ARGS__)
+#define _BAR_ON_13(s, a, ...) _BAR_TERM(a, s) | _BAR_ON_12(s, __VA_ARGS__)
+#define _BAR_ON_14(s, a, ...) _BAR_TERM(a, s) | _BAR_ON_13(s, __VA_ARGS__)
+#define _BAR_ON_15(s, a, ...) _BAR_TERM(a, s) | _BAR_ON_14(s, __VA_ARGS__)
+#define _BAR_ON_16(s, a, ...) _BAR_TERM(a, s) | _BAR_ON_15(s, __VA_ARGS__)
+/* segments of the list within the RAM byte of segment s */
+#define _BAR_ON(s, ...)                                                        \
+  (_BAR_CAT(_BAR_ON_, _BAR_NARG(__VA_ARGS__))(s, __VA_ARGS__))
+#define _BAR_SFX_1(f, node, all, a) f(node, all, a)
+#define _BAR_SFX_2(f, node, all, a, ...)                                       \
+  f(node, all, a, __VA_ARGS__) _BAR_SFX_1(f, node, all, __VA_ARGS__)
+#define _BAR_SFX_3(f, node, all, a, ...)                                       \
+  f(node, all, a, __VA_ARGS__) _BAR_SFX_2(f, node, all, __VA_ARGS__)
+#define _BAR_SFX_4(f, node, all, a, ...)                                       \
+  f(node, all, a, __VA_ARGS__) _BAR_SFX_3(f, node, all, __VA_ARGS__)
+#define _BAR_SFX_5(f, node, all, a, ...)                                       \
+  f(node, all, a, __VA_ARGS__) _BAR_SFX_4(f, node, all, __VA_ARGS__)
+#define _BAR_SFX_6(f, node, all, a, ...)                                       \
+  f(node, all, a, __VA_ARGS__) _BAR_SFX_5(f, node, all, __VA_ARGS__)
+#define _BAR_SFX_7(f, node, all, a, ...)                                       \
+  f(node, all, a, __VA_ARGS__) _BAR_SFX_6(f, node, all, __VA_ARGS__)
+#define _BAR_SFX_8(f, node, all, a, ...)                                       \
+  f(node, all, a, __VA_ARGS__) _BAR_SFX_7(f, node, all, __VA_ARGS__)
+#define _BAR_SFX_9(f, node, all, a, ...)                                       \
+  f(node, all, a, __VA_ARGS__) _BAR_SFX_8(f, node, all, __VA_ARGS__)
+#define _BAR_SFX_10(f, node, all, a, ...)                                      \
+  f(node, all, a, __VA_ARGS__) _BAR_SFX_9(f, node, all, __VA_ARGS__)
+#define _BAR_SFX_11(f, node, all, a, ...)                                      \
+  f(node, all, a, __VA_ARGS__) _BAR_SFX_10(f, node, all, __VA_ARGS__)
+#define _BAR_SFX_12(f, node, all, a, ...)                                      \
+  f(node, all, a, __VA_ARGS__) _BAR_SFX_11(f, node, all, __VA_ARGS__)
+#define _BAR_SFX_13(f, node, all, a, ...)                                      \
+  f(node, all, a, __VA_ARGS__) _BAR_SFX_12(f, node, all, __VA_ARGS__)
+#define _BAR_SFX_14(f, node, all, a, ...)                                      \
+  f(node, all, a, __VA_ARGS__) _BAR_SFX_13(f, node, all, __VA_ARGS__)
+#define _BAR_SFX_15(f, node, all, a, ...)                                      \
+  f(node, all, a, __VA_ARGS__) _BAR_SFX_14(f, node, all, __VA_ARGS__)
+#define _BAR_SFX_16(f, node, all, a, ...)                                      \
+  f(node, all, a, __VA_ARGS__) _BAR_SFX_15(f, node, all, __VA_ARGS__)
+/* f(node, all, suffix...) for every suffix of the segment list, longest
+ * first */
+#define _BAR_SUFFIXES(f, node, all) _BAR_SUFFIXES_(f, node, all, _BAR_LIST all)
+#define _BAR_SUFFIXES_(f, node, all, ...)                                      \
+  _BAR_CAT(_BAR_SFX_, _BAR_NARG(__VA_ARGS__))(f, node, all, __VA_ARGS__)
+
+/* the last segment of the bar in its RAM byte owns the slot */
+#define _BAR_MASK(node, all, ...)                                              \
+  (PCF8576_SEG_NODE_MASK(_BAR_HEAD(__VA_ARGS__)) != 0 &&                       \
+           _BAR_ON(_BAR_HEAD(__VA_ARGS__), __VA_ARGS__) ==                     \
+               PCF8576_SEG_NODE_MASK(_BAR_HEAD(__VA_ARGS__))                   \
+       ? _BAR_ON(_BAR_HEAD(__VA_ARGS__), _BAR_LIST all)                        \
+       : 0),
+/* the level below a suffix of the bar lights every segment but the suffix */
+#define _BAR_LEVEL_SLOT(item, all, ...)                                        \
+  (_BAR_ON(_BAR_SEG(item), _BAR_LIST all) &                                    \
+   ~_BAR_ON(_BAR_SEG(item), __VA_ARGS__)),
+#define _BAR_LEVEL(node, all, ...)                                             \
+  DT_FOREACH_CHILD_VARGS(node, _BAR_LEVEL_SLOT, all, __VA_ARGS__)
+#define _BAR_FULL_SLOT(item, all) _BAR_ON(_BAR_SEG(item), _BAR_LIST all),
 
+#define _BAR_MAP(label, node, all)                                             \
+  static const uint8_t barbyte_##label[] = {                                   \
+      DT_FOREACH_CHILD(node, _BAR_BYTE)};                                      \
+  static const uint8_t barmask_##label[] = {                                   \
+      _BAR_SUFFIXES(_BAR_MASK, node, all)};                                    \
+  static const uint8_t barlevel_##label[] = {                                  \
+      _BAR_SUFFIXES(_BAR_LEVEL, node, all)                                     \
+          DT_FOREACH_CHILD_VARGS(node, _BAR_FULL_SLOT, all)};                  \
+  const struct pcf8576_bar_map barmap_##label = {                              \
+      .byte = barbyte_##label,                                                 \
+      .mask = barmask_##label,                                                 \
+      .level = barlevel_##label,                                               \
+      .count = ARRAY_SIZE(barbyte_##label),                                    \
+  };
+#define _BAR_MAP_NODES(label, node, ...) _BAR_MAP(label, node, (__VA_ARGS__))
+#define _BAR_MAP_LIST(label, ...) _BAR_MAP_NODES(label, __VA_ARGS__)
+
+/* the per level RAM masks are generated from the segment list of the bar,
+ * at most PCF8576_BAR_MAX_SEGMENTS long */
 #define pcf8576_bar_define(label)                                              \
-  const uint8_t bararray_##label[][2] = {                                      \
-      DT_FOREACH_CHILD(DT_NODELABEL(label), _BAR_CFG)};
-
-#define pcf8576_bar_declare(label) extern const uint8_t bararray_##label[][2];
-
-#define _NUMBERS_CFG(item)                                                     \
-  {SEG2SHIFT(                                                                  \
-       DT_PROP_BY_IDX(DT_PHANDLE_BY_IDX(DT_PHANDLE(item, number), digit, 0),   \
-                      segment, 0),                                             \
-       DT_PROP_BY_IDX(DT_PHANDLE_BY_IDX(DT_PHANDLE(item, number), digit, 0),   \
-                      segment, 1)),                                            \
-   SEG2SHIFT(                                                                  \
-       DT_PROP_BY_IDX(DT_PHANDLE_BY_IDX(DT_PHANDLE(item, number), digit, 1),   \
-                      segment, 0),                                             \
-       DT_PROP_BY_IDX(DT_PHANDLE_BY_IDX(DT_PHANDLE(item, number), digit, 1),   \
-                      segment, 1)),                                            \
-   SEG2SHIFT(                                                                  \
-       DT_PROP_BY_IDX(DT_PHANDLE_BY_IDX(DT_PHANDLE(item, number), digit, 2),   \
-                      segment, 0),                                             \
-       DT_PROP_BY_IDX(DT_PHANDLE_BY_IDX(DT_PHANDLE(item, number), digit, 2),   \
-                      segment, 1)),                                            \
-   SEG2SHIFT(                                                                  \
-       DT_PROP_BY_IDX(DT_PHANDLE_BY_IDX(DT_PHANDLE(item, number), digit, 3),   \
-                      segment, 0),                                             \
-       DT_PROP_BY_IDX(DT_PHANDLE_BY_IDX(DT_PHANDLE(item, number), digit, 3),   \
-                      segment, 1)),                                            \
-   SEG2SHIFT(                                                                  \
-       DT_PROP_BY_IDX(DT_PHANDLE_BY_IDX(DT_PHANDLE(item, number), digit, 4),   \
-                      segment, 0),                                             \
-       DT_PROP_BY_IDX(DT_PHANDLE_BY_IDX(DT_PHANDLE(item, number), digit, 4),   \
-                      segment, 1)),                                            \
-   SEG2SHIFT(                                                                  \
-       DT_PROP_BY_IDX(DT_PHANDLE_BY_IDX(DT_PHANDLE(item, number), digit, 5),   \
-                      segment, 0),                                             \
-       DT_PROP_BY_IDX(DT_PHANDLE_BY_IDX(DT_PHANDLE(item, number), digit, 5),   \
-                      segment, 1)),                                            \
-   SEG2SHIFT(                                                                  \
-       DT_PROP_BY_IDX(DT_PHANDLE_BY_IDX(DT_PHANDLE(item, number), digit, 6),   \
-                      segment, 0),                                             \
-       DT_PROP_BY_IDX(DT_PHANDLE_BY_IDX(DT_PHANDLE(item, number), digit, 6),   \
-                      segment, 1)),                                            \
-   SEG2SHIFT(                                                                  \
-       DT_PROP_BY_IDX(DT_PHANDLE_BY_IDX(DT_PHANDLE(item, number), digit, 7),   \
-                      segment, 0),                                             \
-       DT_PROP_BY_IDX(DT_PHANDLE_BY_IDX(DT_PHANDLE(item, number), digit, 7),   \
-                      segment, 1))},
-
-#define pcf8576_num_declare(label) extern const nums_t numarray_##label[];
-
-#if (CONFIG_ZTEST == 1)
+  BUILD_ASSERT(PCF8576_WIDGET_SIZE(label) <= PCF8576_BAR_MAX_SEGMENTS,         \
+               "bar " #label " has more than PCF8576_BAR_MAX_SEGMENTS "        \
+               "segments");                                                    \
+  _BAR_MAP_LIST(label, DT_NODELABEL(label) DT_FOREACH_CHILD(                   \
+                           DT_NODELABEL(label), _BAR_ARG))                     \
+  struct pcf8576_bar_memo barmemo_##label;
+
+#define pcf8576_bar_declare(label)                                             \
+  extern const struct pcf8576_bar_map barmap_##label;                          \
+  extern struct pcf8576_bar_memo barmemo_##label;
+#endif
+
+/* segment j of the lcd-digit node d; segment outputs beyond the largest
+ * possible cascade are treated as unconnected and yield mask 0 */
+#define _DIG_SEG(d, j) DT_PHANDLE_BY_IDX(d, digit, j)
+#define _DIG_SEG_COL(d, j) DT_PROP_BY_IDX(_DIG_SEG(d, j), segment, 1)
+#define _DIG_SEG_MASK(d, j)                                                    \
+  (_DIG_SEG_COL(d, j) < PCF8576_COLUMNS * PCF8576_MAX_DEVICES                  \
+       ? PCF8576_SEG_NODE_MASK(_DIG_SEG(d, j))                                 \
+       : 0)
+#define _DIG_SEG_BYTE(d, j)                                                    \
+  (_DIG_SEG_COL(d, j) < PCF8576_COLUMNS * PCF8576_MAX_DEVICES                  \
+       ? PCF8576_SEG_NODE_BYTE(_DIG_SEG(d, j))                                 \
+       : 0)
+
+#define _DIG_SEG_INDEX(d, j)                                                   \
+  (_DIG_SEG_COL(d, j) < PCF8576_COLUMNS * PCF8576_MAX_DEVICES                  \
+       ? PCF8576_SEG_NODE_INDEX(_DIG_SEG(d, j))                                \
+       : PCF8576_SEG_NONE)
+
+#ifdef CONFIG_PCF8576_COMPACT_DESCRIPTORS
+#define _DIGIT_MAP(d)                                                          \
+  {.seg = {_DIG_SEG_INDEX(d, 0), _DIG_SEG_INDEX(d, 1), _DIG_SEG_INDEX(d, 2),    \
+           _DIG_SEG_INDEX(d, 3), _DIG_SEG_INDEX(d, 4), _DIG_SEG_INDEX(d, 5),    \
+           _DIG_SEG_INDEX(d, 6), _DIG_SEG_INDEX(d, 7)}}
+#else
+#define _DIG_OR8(f, d, i, g)                                                   \
+  (f(d, i, 0, g) | f(d, i, 1, g) | f(d, i, 2, g) | f(d, i, 3, g) |             \
+   f(d, i, 4, g) | f(d, i, 5, g) | f(d, i, 6, g) | f(d, i, 7, g))
+/* segment j lives in the RAM byte of slot i */
+#define _DIG_SAME(d, i, j)                                                     \
+  (_DIG_SEG_MASK(d, j) != 0 && _DIG_SEG_BYTE(d, j) == _DIG_SEG_BYTE(d, i))
+#define _DIG_DUP(d, i, j, g) ((j) < (i) && _DIG_SAME(d, i, j))
+#define _DIG_TERM(d, i, j, g)                                                  \
+  (((((g) >> (j)) & 1) && _DIG_SAME(d, i, j)) ? _DIG_SEG_MASK(d, j) : 0)
+#define _DIG_USED(d, i) (_DIG_SEG_MASK(d, i) != 0 && !_DIG_OR8(_DIG_DUP, d, i, 0))
+#define _DIG_SLOT(d, i, g) (_DIG_USED(d, i) ? _DIG_OR8(_DIG_TERM, d, i, g) : 0)
+#define _DIG_ROW(d, g)                                                         \
+  {_DIG_SLOT(d, 0, g), _DIG_SLOT(d, 1, g), _DIG_SLOT(d, 2, g),                 \
+   _DIG_SLOT(d, 3, g), _DIG_SLOT(d, 4, g), _DIG_SLOT(d, 5, g),                 \
+   _DIG_SLOT(d, 6, g), _DIG_SLOT(d, 7, g)}
+
+#define _DIGIT_MAP(d)                                                          \
+  {.byte = {_DIG_SEG_BYTE(d, 0), _DIG_SEG_BYTE(d, 1), _DIG_SEG_BYTE(d, 2),     \
+            _DIG_SEG_BYTE(d, 3), _DIG_SEG_BYTE(d, 4), _DIG_SEG_BYTE(d, 5),     \
+            _DIG_SEG_BYTE(d, 6), _DIG_SEG_BYTE(d, 7)},                         \
+   .mask = _DIG_ROW(d, 0xff),                                                  \
+   .glyph = {_DIG_ROW(d, PCF8576_GLYPH_0), _DIG_ROW(d, PCF8576_GLYPH_1),       \
+             _DIG_ROW(d, PCF8576_GLYPH_2), _DIG_ROW(d, PCF8576_GLYPH_3),       \
+             _DIG_ROW(d, PCF8576_GLYPH_4), _DIG_ROW(d, PCF8576_GLYPH_5),       \
+             _DIG_ROW(d, PCF8576_GLYPH_6), _DIG_ROW(d, PCF8576_GLYPH_7),       \
+             _DIG_ROW(d, PCF8576_GLYPH_8), _DIG_ROW(d, PCF8576_GLYPH_9),       \
+             _DIG_ROW(d, PCF8576_GLYPH_NEG), _DIG_ROW(d, PCF8576_GLYPH_DP)}}
+#endif
+
+#define _NUMBERS_CFG(item) _DIGIT_MAP(DT_PHANDLE(item, number)),
+
+/* last rendered state of a widget. Rendering a widget from several
+ * contexts at the same time is not supported. */
+struct pcf8576_num_memo {
+  const struct device *dev; /* NULL until the first render */
+  uint32_t value;           /* mantissa or bit pattern of the float value */
+  uint8_t decimals;         /* PCF8576_NUM_MEMO_FLOAT for float values */
+  uint8_t flags;
+};
+
+struct pcf8576_bar_memo {
+  const struct device *dev; /* NULL until the first render */
+  size_t level;
+};
+
+#define PCF8576_NUM_MEMO_FLOAT 0xff
+/* no value is known but the digits array matches the display */
+#define PCF8576_NUM_MEMO_NONE 0xfe
+
+#define pcf8576_num_declare(label)                                             \
+  extern const nums_t numarray_##label[PCF8576_WIDGET_SIZE(label)];            \
+  extern uint8_t digitarray_##label[PCF8576_WIDGET_SIZE(label)];               \
+  extern struct pcf8576_num_memo nummemo_##label;
+
+/* digitarray holds the digits shown, so that only changed digits are
+ * rewritten */
 #define pcf8576_num_define(label)                                              \
   const nums_t numarray_##label[] = {                                          \
       DT_FOREACH_CHILD(DT_NODELABEL(label), _NUMBERS_CFG)};                    \
-      uint8_t digitarray_##label[sizeof(numarray_##label) / sizeof(nums_t)];
+  uint8_t digitarray_##label[ARRAY_SIZE(numarray_##label)];                    \
+  struct pcf8576_num_memo nummemo_##label;
 
-#define pcf8576_num(dev, label, value)                                         \
+/* the conversion is skipped if the same value was rendered last time */
+#define _pcf8576_num_render(dev, label, value, decimals, flags, convert, ...)   \
   do {                                                                         \
-    _pcf8576_float_to_digits(value, digitarray_##label, sizeof(digitarray_##label));           \
-    for (size_t num_idx = 0; num_idx < sizeof(digitarray_##label); num_idx++) {        \
-      _pcf8576_set_digit(dev, numarray_##label[num_idx], digitarray_##label[num_idx]); \
+    _pcf8576_stats_render(dev);                                                \
+    _pcf8576_trace_render_start(PCF8576_TRACE_NUM, &nummemo_##label);          \
+    if (_pcf8576_num_changed(dev, &nummemo_##label, value, decimals, flags)) {  \
+      uint8_t num_digits[ARRAY_SIZE(numarray_##label)];                        \
+      convert(__VA_ARGS__, num_digits, sizeof(num_digits));                    \
+      _pcf8576_num_show(dev, numarray_##label, digitarray_##label,             \
+                        num_digits, sizeof(num_digits), &nummemo_##label);     \
     }                                                                          \
+    _pcf8576_trace_render_end(PCF8576_TRACE_NUM, &nummemo_##label);            \
   } while (0)
-#else
-#define pcf8576_num_define(label)                                              \
-  const nums_t numarray_##label[] = {                                          \
-      DT_FOREACH_CHILD(DT_NODELABEL(label), _NUMBERS_CFG)};
 
 #define pcf8576_num(dev, label, value)                                         \
   do {                                                                         \
-    uint8_t digitarray[sizeof(numarray_##label) / sizeof(nums_t)];             \
-    _pcf8576_float_to_digits(value, digitarray, sizeof(digitarray));           \
-    for (size_t num_idx = 0; num_idx < sizeof(digitarray); num_idx++) {        \
-      _pcf8576_set_digit(dev, numarray_##label[num_idx], digitarray[num_idx]); \
-    }                                                                          \
+    float num_val = (value);                                                   \
+    _pcf8576_num_render(dev, label, _pcf8576_float_key(num_val),               \
+                        PCF8576_NUM_MEMO_FLOAT, 0, _pcf8576_float_to_digits,   \
+                        num_val);                                              \
   } while (0)
 
-#endif
+#define pcf8576_num_fixed_opt(dev, label, mantissa, decimals, flags)           \
+  do {                                                                         \
+    int32_t num_mantissa = (mantissa);                                         \
+    uint8_t num_decimals = (decimals);                                         \
+    uint8_t num_flags = (flags);                                               \
+    _pcf8576_num_render(dev, label, (uint32_t)num_mantissa, num_decimals,      \
+                        num_flags, _pcf8576_fixed_to_digits, num_mantissa,     \
+                        num_decimals, num_flags);                              \
+  } while (0)
+
+#define pcf8576_num_fixed(dev, label, mantissa, decimals)                      \
+  pcf8576_num_fixed_opt(dev, label, mantissa, decimals, 0)
 
+#define pcf8576_num_int(dev, label, value)                                     \
+  pcf8576_num_fixed_opt(dev, label, value, 0, 0)
+
+/* levels below 0 or above the number of segments are rejected with -EINVAL
+ * and leave the bar unchanged */
+#ifdef CONFIG_PCF8576_COMPACT_DESCRIPTORS
+/* only the segments between the previous and the new level are written */
+#define pcf8576_bar(dev, label, value)                                         \
+  _pcf8576_bar_render(dev, bararray_##label, ARRAY_SIZE(bararray_##label),     \
+                      value, &barmemo_##label)
+#else
+/* one masked write per RAM byte in which the previous and the new level
+ * differ */
 #define pcf8576_bar(dev, label, value)                                         \
+  _pcf8576_bar_render(dev, &barmap_##label, value, &barmemo_##label)
+#endif
+
+/**
+ * @brief Transfer the modified part of the RAM mirror to the device.
+ *
+ * Blocks until the transfer has finished. On bank-buffered devices the
+ * frame is written into the hidden RAM bank, which is then shown with a
+ * single BANK SELECT command in the same transaction.
+ *
+ * @return 0 on success, negative errno code on I2C failure.
+ */
+int pcf8576_flush(const struct device *dev);
+
+/* BLINK frequencies, in the order of the blink-frequency DT property */
+enum pcf8576_blink_freq {
+  PCF8576_BLINK_OFF,
+  PCF8576_BLINK_2HZ,
+  PCF8576_BLINK_1HZ,
+  PCF8576_BLINK_0_5HZ,
+};
+
+enum pcf8576_blink_mode {
+  /* all segments blink */
+  PCF8576_BLINK_NORMAL,
+  /* the display alternates between the two RAM banks, 1:1 and 1:2 mux only.
+   * The driver keeps bank 1 blank, so the shown segments blink */
+  PCF8576_BLINK_ALT_BANK,
+};
+
+/**
+ * @brief Let the controller blink the display.
+ *
+ * Blinking runs on the chip, no flush is needed to keep it going. The
+ * command is sent immediately to all devices of the cascade.
+ *
+ * @retval 0 on success.
+ * @retval -ENOTSUP alternate bank blinking with more than 2 backplanes.
+ * @retval -EBUSY alternate bank blinking on a bank-buffered device, both
+ * banks hold frames.
+ * @return negative errno code on I2C failure.
+ */
+int pcf8576_blink(const struct device *dev, enum pcf8576_blink_freq freq,
+                  enum pcf8576_blink_mode mode);
+
+/**
+ * @brief Open a frame of several widget updates.
+ *
+ * Flushes requested until the matching pcf8576_frame_commit() do not send
+ * anything, so a half-rendered frame never reaches the display. Widget
+ * updates are not blocked, also not by a running transfer. A flush that was
+ * copying the RAM mirror when the frame was opened discards its copy, a
+ * transfer already on the bus only carries the state from before the frame.
+ * Frames nest and may be opened from ISRs.
+ */
+void pcf8576_frame_begin(const struct device *dev);
+
+/**
+ * @brief Close a frame opened by pcf8576_frame_begin().
+ *
+ * Closing the outermost frame performs the flushes deferred while it was
+ * open: in thread context the display is flushed before returning, in ISR
+ * context a flush request is queued with CONFIG_PCF8576_FLUSH_COALESCE,
+ * otherwise the changes are sent by the next flush.
+ *
+ * @return 0 or the result of the deferred flush.
+ */
+int pcf8576_frame_commit(const struct device *dev);
+
+/**
+ * @brief Write the modified part of the RAM mirror into a RAM bank.
+ *
+ * Only available on bank-buffered devices. The shown bank is not changed,
+ * so two frames can be preloaded and switched with pcf8576_bank_show().
+ *
+ * @retval 0 on success.
+ * @retval -EBUSY a frame is open or was opened during the copy.
+ * @retval -ENOTSUP the device is not bank-buffered.
+ * @retval -EINVAL bank is not 0 or 1.
+ * @return negative errno code on I2C failure.
+ */
+int pcf8576_flush_bank(const struct device *dev, uint8_t bank);
+
+/**
+ * @brief Show a RAM bank of a bank-buffered device.
+ *
+ * Sends a single BANK SELECT command, the RAM contents are not touched.
+ *
+ * @retval 0 on success.
+ * @retval -ENOTSUP the device is not bank-buffered.
+ * @retval -EINVAL bank is not 0 or 1.
+ * @return negative errno code on I2C failure.
+ */
+int pcf8576_bank_show(const struct device *dev, uint8_t bank);
+
+#ifdef CONFIG_PCF8576_FLUSH_COALESCE
+/**
+ * @brief Request a flush from the driver's work item.
+ *
+ * Requests are coalesced: at most one flush is performed per
+ * CONFIG_PCF8576_FLUSH_PERIOD_MS, and every request is served by a flush
+ * that starts no later than one period after it.
+ */
+void pcf8576_flush_request(const struct device *dev);
+#endif
+
+#ifdef CONFIG_PCF8576_MARQUEE
+/* animation of a number widget, see pcf8576_marquee_text */
+struct pcf8576_marquee {
+  const struct device *dev;
+  const nums_t *map;
+  uint8_t *shown;
+  struct pcf8576_num_memo *memo;
+  size_t width;
+  size_t len;  /* digits in buf */
+  size_t step; /* 1 when scrolling, width when stepping through frames */
+  int pos;     /* buf index of the leftmost digit of the next window */
+  int first;
+  int last;
+  uint32_t period_ms;
+  bool loop;
+  struct k_work_delayable work;
+  uint8_t buf[CONFIG_PCF8576_MARQUEE_MAX_LEN];
+};
+
+/* bind a marquee to a number widget of dev */
+#define pcf8576_marquee_init(mq, dev, label)                                   \
+  _pcf8576_marquee_init(mq, dev, numarray_##label, digitarray_##label,        \
+                        &nummemo_##label, ARRAY_SIZE(numarray_##label))
+
+/**
+ * @brief Scroll a text from right to left through a number widget.
+ *
+ * The text may contain digits, '-', ' ' and decimal points ('.' or ','),
+ * which are shown on the preceding digit. It is converted once, then every
+ * @p period_ms the window moves by one digit and is flushed. The text
+ * enters at the right edge; without @p loop the marquee stops with its last
+ * digit on the leftmost position. An animation already running on @p mq is
+ * stopped first. The widget must not be rendered otherwise while the
+ * marquee runs.
+ *
+ * @retval 0 on success.
+ * @retval -EINVAL empty text, zero period or a character that can't be shown.
+ * @retval -ENOMEM the text is longer than CONFIG_PCF8576_MARQUEE_MAX_LEN.
+ */
+int pcf8576_marquee_text(struct pcf8576_marquee *mq, const char *text,
+                         uint32_t period_ms, bool loop);
+
+/**
+ * @brief Show a sequence of frames on a number widget.
+ *
+ * Each frame is a text as for pcf8576_marquee_text() that fits the widget,
+ * shorter frames are right aligned. One frame is shown every @p period_ms.
+ *
+ * @retval 0 on success.
+ * @retval -EINVAL no frames, zero period or a frame that can't be shown.
+ * @retval -ENOMEM the frames take more than CONFIG_PCF8576_MARQUEE_MAX_LEN
+ * digits.
+ */
+int pcf8576_marquee_frames(struct pcf8576_marquee *mq,
+                           const char *const frames[], size_t count,
+                           uint32_t period_ms, bool loop);
+
+/**
+ * @brief Stop a marquee, leaving the last shown window on the display.
+ *
+ * Waits for a running step to finish, so it must not be called from the
+ * workqueue running the marquee.
+ */
+void pcf8576_marquee_stop(struct pcf8576_marquee *mq);
+#endif
+
+#ifdef CONFIG_PCF8576_ASYNC
+/**
+ * @brief Flush completion callback.
+ *
+ * Called from the I2C driver's completion context (typically an ISR).
+ */
+typedef void (*pcf8576_flush_cb_t)(const struct device *dev, int result,
+                                   void *user_data);
+
+/**
+ * @brief Start a non-blocking flush of the RAM mirror.
+ *
+ * The modified bytes are copied to a transmit buffer before the transfer
+ * starts, so the application can render the next frame while this one is
+ * on the wire. If nothing has changed, @p cb is called immediately. On
+ * controllers without callback support the transfer completes, and @p cb is
+ * called, before the function returns.
+ *
+ * @retval 0 transfer started (or nothing to do).
+ * @retval -EBUSY a previous transfer is still in progress.
+ */
+int pcf8576_flush_async(const struct device *dev, pcf8576_flush_cb_t cb,
+                        void *user_data);
+
+/**
+ * @brief Start a non-blocking flush, raising @p sig with the result.
+ */
+int pcf8576_flush_signal(const struct device *dev, struct k_poll_signal *sig);
+
+/**
+ * @brief Flush several devices concurrently.
+ *
+ * The transfers of devices on different I2C buses run in parallel, devices
+ * sharing a bus are flushed one after the other. Blocks until all transfers
+ * have completed. A device must not appear twice in @p devs, and must not be
+ * part of two groups being flushed at the same time.
+ *
+ * @return 0 on success, otherwise the first error reported by a device.
+ */
+int pcf8576_flush_group(const struct device *const devs[], size_t count);
+#endif
+
+/**
+ * @brief Widget updates collected for lcd_submit().
+ *
+ * The batch macros render widgets into a list of masked RAM byte writes
+ * instead of the RAM mirror. They touch neither the driver data nor the
+ * memos of the widgets, so user mode threads can use them and apply all
+ * updates with a single system call. Writes to the same RAM byte are merged,
+ * and every widget is rendered in full. A widget shall be rendered either by
+ * batches or by the direct macros, whose memos do not see batch updates.
+ */
+struct pcf8576_batch {
+  struct lcd_segment_update *updates;
+  size_t size;
+  size_t count;
+  /* an update did not fit, the batch is dropped by the submit */
+  bool overflow;
+};
+
+/**
+ * @brief Start an empty batch in the @p size entries of @p updates.
+ */
+void pcf8576_batch_init(struct pcf8576_batch *batch,
+                        struct lcd_segment_update *updates, size_t size);
+
+/**
+ * @brief Apply the updates of a batch with lcd_submit() and empty it.
+ *
+ * @return the result of lcd_submit(), -ENOMEM if the batch had overflowed,
+ * in which case nothing is applied.
+ */
+int pcf8576_batch_submit(const struct device *dev, struct pcf8576_batch *batch,
+                         uint32_t flags);
+
+#define pcf8576_batch_sign(batch, label, state)                                \
+  do {                                                                         \
+    static const pcf8576_seg_t tmp_seg =                                       \
+        PCF8576_SEG_DESC(DT_PHANDLE(DT_NODELABEL(label), sign));               \
+    _pcf8576_batch_sign(batch, tmp_seg, state);                                \
+  } while (0)
+
+#define _pcf8576_batch_num_render(batch, label, convert, ...)                  \
   do {                                                                         \
-    size_t idx = (sizeof(bararray_##label) / 2);                               \
-    do {                                                                       \
-      _pcf8576_clear(dev, bararray_##label[--idx]);                            \
-    } while (idx > (size_t)value);                                             \
-    do {                                                                       \
-      _pcf8576_set(dev, bararray_##label[--idx]);                              \
-    } while (idx > 0);                                                         \
+    uint8_t num_digits[ARRAY_SIZE(numarray_##label)];                          \
+    convert(__VA_ARGS__, num_digits, sizeof(num_digits));                      \
+    _pcf8576_batch_digits(batch, numarray_##label, num_digits,                 \
+                          sizeof(num_digits));                                 \
   } while (0)
 
-void pcf8576_flush(const struct device *dev);
+#define pcf8576_batch_num(batch, label, value)                                 \
+  _pcf8576_batch_num_render(batch, label, _pcf8576_float_to_digits, (value))
+
+#define pcf8576_batch_num_fixed_opt(batch, label, mantissa, decimals, flags)   \
+  _pcf8576_batch_num_render(batch, label, _pcf8576_fixed_to_digits,            \
+                            (mantissa), (decimals), (flags))
+
+#define pcf8576_batch_num_fixed(batch, label, mantissa, decimals)              \
+  pcf8576_batch_num_fixed_opt(batch, label, mantissa, decimals, 0)
+
+#define pcf8576_batch_num_int(batch, label, value)                             \
+  pcf8576_batch_num_fixed_opt(batch, label, value, 0, 0)
+
+/* out of range levels are rejected like by pcf8576_bar() and add nothing */
+#ifdef CONFIG_PCF8576_COMPACT_DESCRIPTORS
+#define pcf8576_batch_bar(batch, label, value)                                 \
+  _pcf8576_batch_bar(batch, bararray_##label, ARRAY_SIZE(bararray_##label),    \
+                     value)
+#else
+#define pcf8576_batch_bar(batch, label, value)                                 \
+  _pcf8576_batch_bar(batch, &barmap_##label, value)
+#endif
 
 /* internal functions used by the lcd macros. Do not call them directly */
-void _pcf8576_set_digit(const struct device *dev, const uint8_t segment[][2],
+void _pcf8576_set_digit(const struct device *dev, const nums_t *digit,
                         uint8_t value);
-void _pcf8576_float_to_digits(float val, uint8_t digits[], size_t no_digits);
+void _pcf8576_update(const struct device *dev, size_t byte, uint8_t clear,
+                     uint8_t set);
+void _pcf8576_set(const struct device *dev, const pcf8576_seg_t seg);
+void _pcf8576_clear(const struct device *dev, const pcf8576_seg_t seg);
+void _pcf8576_sign(const struct device *dev, const pcf8576_seg_t seg,
+                   bool state);
+void _pcf8576_sign_toggle(const struct device *dev, const pcf8576_seg_t seg);
+bool _pcf8576_num_changed(const struct device *dev,
+                          struct pcf8576_num_memo *memo, uint32_t value,
+                          uint8_t decimals, uint8_t flags);
+void _pcf8576_num_show(const struct device *dev, const nums_t map[],
+                       uint8_t shown[], const uint8_t digits[],
+                       size_t no_digits, struct pcf8576_num_memo *memo);
+#ifdef CONFIG_PCF8576_COMPACT_DESCRIPTORS
+int _pcf8576_bar_render(const struct device *dev, const pcf8576_seg_t segs[],
+                        size_t count, int level,
+                        struct pcf8576_bar_memo *memo);
+#else
+int _pcf8576_bar_render(const struct device *dev,
+                        const struct pcf8576_bar_map *bar, int level,
+                        struct pcf8576_bar_memo *memo);
+#endif
+void _pcf8576_batch_sign(struct pcf8576_batch *batch, const pcf8576_seg_t seg,
+                         bool state);
+void _pcf8576_batch_digits(struct pcf8576_batch *batch, const nums_t map[],
+                           const uint8_t digits[], size_t no_digits);
+#ifdef CONFIG_PCF8576_COMPACT_DESCRIPTORS
+int _pcf8576_batch_bar(struct pcf8576_batch *batch, const pcf8576_seg_t segs[],
+                       size_t count, int level);
+#else
+int _pcf8576_batch_bar(struct pcf8576_batch *batch,
+                       const struct pcf8576_bar_map *bar, int level);
+#endif
+#ifdef CONFIG_PCF8576_MARQUEE
+void _pcf8576_marquee_init(struct pcf8576_marquee *mq,
+                           const struct device *dev, const nums_t map[],
+                           uint8_t shown[], struct pcf8576_num_memo *memo,
+                           size_t width);
+#endif
+#ifdef CONFIG_PCF8576_STATS
+void _pcf8576_stats_render(const struct device *dev);
+#else
+#define _pcf8576_stats_render(dev) ((void)(dev))
+#endif
+
+/* widget kinds of the render trace events, the second argument of which is
+ * the address of the widget's memo or, for signs, segment descriptor */
+enum pcf8576_trace_widget {
+  PCF8576_TRACE_NUM,
+  PCF8576_TRACE_BAR,
+  PCF8576_TRACE_SIGN,
+};
+
+#ifdef CONFIG_PCF8576_TRACING
+#ifdef CONFIG_TRACING_USER
+/**
+ * @brief Receive the driver events with the user tracing format.
+ *
+ * Called with the name and arguments of every event instead of
+ * sys_trace_named_event(). The default implementation is empty; like the
+ * sys_trace_*_user() hooks it is weak and can be overridden.
+ */
+void pcf8576_trace_user(const char *name, uint32_t arg0, uint32_t arg1);
+#endif
+
+void _pcf8576_trace_render_start(enum pcf8576_trace_widget kind,
+                                 const void *widget);
+void _pcf8576_trace_render_end(enum pcf8576_trace_widget kind,
+                               const void *widget);
+#else
+#define _pcf8576_trace_render_start(kind, widget) ((void)0)
+#define _pcf8576_trace_render_end(kind, widget) ((void)0)
+#endif
 
 #endif /* ZEPHYR_INCLUDE_DISPLAY_PCF8576_H_ */
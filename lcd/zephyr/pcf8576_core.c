@@ -0,0 +1,205 @@
+/*
+* Copyright (c) 2022 Karoly Molnar
+*
+* SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "pcf8576_core.h"
+#include <string.h>
+
+static const float _pcf8576_p10[] = {1., 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9};
+static const uint32_t _pcf8576_u10[] = {1,       10,       100,       1000,
+                                        10000,   100000,   1000000,   10000000,
+                                        100000000, 1000000000};
+
+static size_t _pcf8576_count_int_digits(uint32_t number) {
+  size_t cnt =  (number >= 1000000000) ? 10
+        : (number >= 100000000) ? 9
+        : (number >= 10000000) ? 8
+        : (number >= 1000000) ? 7
+        : (number >= 100000) ? 6
+        : (number >= 10000) ? 5
+        : (number >= 1000) ? 4
+        : (number >= 100) ? 3
+        : (number >= 10) ? 2
+        : 1;
+  return cnt;
+}
+
+#ifdef CONFIG_PCF8576_COMPACT_DESCRIPTORS
+static const uint8_t _pcf8576_glyphs[] = {
+    PCF8576_GLYPH_0, PCF8576_GLYPH_1, PCF8576_GLYPH_2,  PCF8576_GLYPH_3,
+    PCF8576_GLYPH_4, PCF8576_GLYPH_5, PCF8576_GLYPH_6,  PCF8576_GLYPH_7,
+    PCF8576_GLYPH_8, PCF8576_GLYPH_9, PCF8576_GLYPH_NEG};
+
+size_t _pcf8576_digit_writes(const nums_t *digit, uint8_t value,
+                             struct pcf8576_write writes[]) {
+  size_t count = 0;
+  uint8_t on = 0;
+  uint8_t byte = 0;
+  uint8_t clear = 0;
+  uint8_t set = 0;
+
+  if (value != DIGIT_BLANK) {
+    if (value >= DIGIT_DP) {
+      on = PCF8576_GLYPH_DP;
+      value -= DIGIT_DP;
+    }
+    on |= _pcf8576_glyphs[value];
+  }
+  /* runs of segments in the same RAM byte are merged into one masked
+   * write; segments are usually laid out in column order, so a digit takes
+   * one or two writes */
+  for (size_t idx = 0; idx < ARRAY_SIZE(digit->seg); idx++) {
+    uint8_t bit = digit->seg[idx];
+
+    if (bit == PCF8576_SEG_NONE) {
+      continue;
+    }
+    if (clear != 0 && bit / 8 != byte) {
+      writes[count++] = (struct pcf8576_write){byte, clear, set};
+      clear = 0;
+      set = 0;
+    }
+    byte = bit / 8;
+    clear |= 0x80 >> (bit % 8);
+    if (on & BIT(idx)) {
+      set |= 0x80 >> (bit % 8);
+    }
+  }
+  if (clear != 0) {
+    writes[count++] = (struct pcf8576_write){byte, clear, set};
+  }
+  return count;
+}
+#else
+size_t _pcf8576_digit_writes(const nums_t *digit, uint8_t value,
+                             struct pcf8576_write writes[]) {
+  const uint8_t *on = NULL;
+  const uint8_t *dp = NULL;
+  size_t count = 0;
+
+  if (value != DIGIT_BLANK) {
+    if (value >= DIGIT_DP) {
+      dp = digit->glyph[PCF8576_GLYPH_IDX_DP];
+      value -= DIGIT_DP;
+    }
+    on = digit->glyph[value];
+  }
+  /* one masked write per RAM byte touched by the digit */
+  for (size_t slot = 0; slot < ARRAY_SIZE(digit->byte); slot++) {
+    if (digit->mask[slot] == 0) {
+      continue;
+    }
+    uint8_t set = (on ? on[slot] : 0) | (dp ? dp[slot] : 0);
+    writes[count++] =
+        (struct pcf8576_write){digit->byte[slot], digit->mask[slot], set};
+  }
+  return count;
+}
+#endif
+
+void _pcf8576_num_ovf(uint8_t digits[], size_t no_digits) {
+  for (size_t idx = 0; idx < no_digits; idx++) {
+    digits[idx] = DIGIT_NEG;
+  }
+}
+
+void _pcf8576_fixed_to_digits(int32_t mantissa, uint8_t decimals,
+                              uint8_t flags, uint8_t digits[],
+                              size_t no_digits) {
+  bool sign = mantissa < 0;
+  uint32_t abs_val = sign ? -(uint32_t)mantissa : (uint32_t)mantissa;
+  uint32_t val = abs_val;
+  uint8_t abs_decimals = decimals;
+  bool fixed_dp = (flags & PCF8576_NUM_FIXED_DP) != 0;
+  size_t val_digits;
+
+  for (;;) {
+    if (!fixed_dp) {
+      while (decimals > 0 && val % 10 == 0) {
+        val /= 10;
+        decimals--;
+      }
+    }
+    /* at least one digit is shown before the decimal point, a zero has no
+     * sign */
+    val_digits = MAX(_pcf8576_count_int_digits(val), (size_t)decimals + 1);
+    if (val_digits + (sign && val != 0 ? 1 : 0) <= no_digits ||
+        decimals == 0) {
+      break;
+    }
+    /* does not fit: drop the last fractional digit. The value is rounded
+     * from the original mantissa, rounding the rounded value again would
+     * carry 0.45 up to 1 */
+    decimals--;
+    size_t drop = abs_decimals - decimals;
+    val = drop < ARRAY_SIZE(_pcf8576_u10)
+              ? (abs_val + _pcf8576_u10[drop] / 2) / _pcf8576_u10[drop]
+              : 0;
+  }
+  if (val == 0) {
+    sign = false;
+  }
+  if (val_digits + (sign ? 1 : 0) > no_digits) {
+    _pcf8576_num_ovf(digits, no_digits);
+    return;
+  }
+
+  int idx = no_digits - 1;
+  for (size_t pos = 0; pos < val_digits; pos++, idx--) {
+    digits[idx] = val % 10;
+    val /= 10;
+    if (pos == decimals && decimals > 0) {
+      digits[idx] += DIGIT_DP;
+    }
+  }
+  if (flags & PCF8576_NUM_LEADING_ZEROS) {
+    for (; idx >= 0; idx--) {
+      digits[idx] = 0;
+    }
+    if (sign) {
+      digits[0] = DIGIT_NEG;
+    }
+  } else {
+    if (sign) {
+      digits[idx--] = DIGIT_NEG;
+    }
+    for (; idx >= 0; idx--) {
+      digits[idx] = DIGIT_BLANK;
+    }
+  }
+}
+
+void _pcf8576_float_to_digits(float val, uint8_t digits[], size_t no_digits) {
+  bool sign = val < 0;
+  float abs_val = sign ? -val : val;
+
+  if (!(abs_val < (float)INT32_MAX)) {
+    _pcf8576_num_ovf(digits, no_digits);
+    return;
+  }
+  size_t int_digits = _pcf8576_count_int_digits((uint32_t)abs_val);
+  int_digits += sign ? 1 : 0;
+  if (int_digits > no_digits) {
+    _pcf8576_num_ovf(digits, no_digits);
+    return;
+  }
+
+  /* scale to as many decimals as the number can show, the integer
+   * converter drops the trailing zeros */
+  size_t decimals = MIN(no_digits - int_digits, ARRAY_SIZE(_pcf8576_p10) - 1);
+  while (decimals > 0 && abs_val * _pcf8576_p10[decimals] >= (float)INT32_MAX) {
+    decimals--;
+  }
+  int32_t mantissa = (int32_t)(abs_val * _pcf8576_p10[decimals] + 0.5f);
+  _pcf8576_fixed_to_digits(sign ? -mantissa : mantissa, decimals, 0, digits,
+                           no_digits);
+}
+
+uint32_t _pcf8576_float_key(float value) {
+  uint32_t key;
+
+  memcpy(&key, &value, sizeof(key));
+  return key;
+}
@@ -0,0 +1,156 @@
+/*
+* Copyright (c) 2022 Karoly Molnar
+*
+* SPDX-License-Identifier: Apache-2.0
+*/
+
+/*
+ * Segment rendering core of the PCF8576 driver: the RAM layout of segments,
+ * 7-segment glyphs and the number to digit converters. It does not depend on
+ * the kernel and also builds as a plain host library, see lcd/host.
+ */
+
+#ifndef ZEPHYR_INCLUDE_DISPLAY_PCF8576_CORE_H_
+#define ZEPHYR_INCLUDE_DISPLAY_PCF8576_CORE_H_
+
+#ifdef __ZEPHYR__
+#include <zephyr/sys/util.h>
+#include <zephyr/types.h>
+#else
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define BIT(n) (1UL << (n))
+#define ARRAY_SIZE(array) (sizeof(array) / sizeof((array)[0]))
+#define DIV_ROUND_UP(n, d) (((n) + (d)-1) / (d))
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+/* number of segment outputs of one device */
+#define PCF8576_COLUMNS 40
+/* maximum number of devices cascaded on one I2C address */
+#define PCF8576_MAX_DEVICES 8
+
+/* segment outputs covered by one RAM byte and RAM bytes of one device in
+ * 1:mux multiplex mode. In 1:3 mode a byte fills two and two thirds
+ * columns, row 2 of the third column is left untouched by the device. */
+#define PCF8576_COLS_PER_BYTE(mux) ((mux) == 3 ? 3 : 8 / (mux))
+#define PCF8576_DEV_BYTES(mux)                                                 \
+  DIV_ROUND_UP(PCF8576_COLUMNS, PCF8576_COLS_PER_BYTE(mux))
+
+/* RAM bit mask and RAM byte of the segment on backplane x, segment output y
+ * in 1:mux multiplex mode. Segment outputs of cascaded devices are numbered
+ * contiguously, i.e. the first output of the second device is 40. Segments
+ * that cannot be written (backplane not driven, row 2 of every third column
+ * in 1:3 mode) get mask 0. */
+#define _PCF8576_SEG_BIT(mux, x, y)                                            \
+  ((y) % PCF8576_COLUMNS % PCF8576_COLS_PER_BYTE(mux) * (mux) + (x))
+#define PCF8576_SEG_MASK_MUX(mux, x, y)                                        \
+  ((x) < (mux) && _PCF8576_SEG_BIT(mux, x, y) < 8                              \
+       ? 1 << (7 - _PCF8576_SEG_BIT(mux, x, y))                                \
+       : 0)
+#define PCF8576_SEG_BYTE_MUX(mux, x, y)                                        \
+  ((y) / PCF8576_COLUMNS * PCF8576_DEV_BYTES(mux) +                            \
+   (y) % PCF8576_COLUMNS / PCF8576_COLS_PER_BYTE(mux))
+
+/* 1:4 multiplex layout */
+#define PCF8576_SEG_MASK(x, y) PCF8576_SEG_MASK_MUX(4, x, y)
+#define PCF8576_SEG_BYTE(x, y) PCF8576_SEG_BYTE_MUX(4, x, y)
+
+#define SEG2SHIFT(x, y)                                                        \
+  { PCF8576_SEG_MASK(x, y), PCF8576_SEG_BYTE(x, y) }
+/* RAM bit index of a segment, bit 7 of RAM byte 0 being index 0. In 1:4 mode
+ * this is 4 * segment output + backplane. Segments that cannot be written
+ * get PCF8576_SEG_NONE. */
+#define PCF8576_SEG_NONE 0xff
+#define PCF8576_SEG_INDEX_MUX(mux, x, y)                                       \
+  (PCF8576_SEG_MASK_MUX(mux, x, y)                                             \
+       ? PCF8576_SEG_BYTE_MUX(mux, x, y) * 8 + _PCF8576_SEG_BIT(mux, x, y)     \
+       : PCF8576_SEG_NONE)
+/* segment descriptor used by the widget tables: the RAM bit index with
+ * CONFIG_PCF8576_COMPACT_DESCRIPTORS, otherwise RAM bit mask and RAM byte */
+#ifdef CONFIG_PCF8576_COMPACT_DESCRIPTORS
+typedef uint8_t pcf8576_seg_t[1];
+#else
+typedef uint8_t pcf8576_seg_t[2];
+#endif
+
+/* 7-segment glyphs, bit n is the n-th segment of an lcd-digit (a..g, dp) */
+#define PCF8576_GLYPH_0 0x3f
+#define PCF8576_GLYPH_1 0x06
+#define PCF8576_GLYPH_2 0x5b
+#define PCF8576_GLYPH_3 0x4f
+#define PCF8576_GLYPH_4 0x66
+#define PCF8576_GLYPH_5 0x6d
+#define PCF8576_GLYPH_6 0x7d
+#define PCF8576_GLYPH_7 0x07
+#define PCF8576_GLYPH_8 0x7f
+#define PCF8576_GLYPH_9 0x6f
+#define PCF8576_GLYPH_NEG 0x40
+#define PCF8576_GLYPH_DP 0x80
+
+#define PCF8576_GLYPH_IDX_NEG 10
+#define PCF8576_GLYPH_IDX_DP 11
+
+#ifdef CONFIG_PCF8576_COMPACT_DESCRIPTORS
+/**
+ * @brief RAM bit index of each segment of a 7-segment digit (a..g, dp).
+ *
+ * The glyphs are shared by all digits and mapped to RAM bits when the digit
+ * is rendered.
+ */
+struct pcf8576_digit_map {
+  uint8_t seg[8];
+};
+#else
+/**
+ * @brief Precomputed RAM masks of a 7-segment digit.
+ *
+ * The 8 segments of a digit are grouped by the RAM byte they live in. Each
+ * slot describes one RAM byte touched by the digit; slots that refer to a
+ * byte already covered by an earlier slot, or to a segment that is not
+ * connected, have an all-zero mask and are skipped.
+ */
+struct pcf8576_digit_map {
+  uint8_t byte[8];      /* RAM byte of the slot */
+  uint8_t mask[8];      /* all segments of the digit within that byte */
+  uint8_t glyph[12][8]; /* segments to turn on for 0..9, minus and DP */
+};
+#endif
+
+typedef struct pcf8576_digit_map nums_t;
+
+/* digit codes produced by the converters: 0..9, DIGIT_NEG for the minus
+ * sign, DIGIT_BLANK for an empty digit, plus DIGIT_DP for a decimal point
+ * after the digit */
+#define DIGIT_BLANK (30)
+#define DIGIT_DP (20)
+#define DIGIT_NEG (10)
+
+/* number rendering options, see pcf8576_num_fixed_opt */
+#define PCF8576_NUM_LEADING_ZEROS BIT(0) /* pad with zeros instead of blanks */
+#define PCF8576_NUM_FIXED_DP BIT(1)      /* keep trailing fractional zeros */
+
+/* masked write of a RAM byte: the bits in clear are replaced by set */
+struct pcf8576_write {
+  uint8_t byte;
+  uint8_t clear;
+  uint8_t set;
+};
+
+/* most RAM bytes a digit can touch */
+#define PCF8576_DIGIT_MAX_WRITES 8
+
+/* internal functions used by the lcd macros. Do not call them directly */
+size_t _pcf8576_digit_writes(const nums_t *digit, uint8_t value,
+                             struct pcf8576_write writes[]);
+void _pcf8576_num_ovf(uint8_t digits[], size_t no_digits);
+void _pcf8576_float_to_digits(float val, uint8_t digits[], size_t no_digits);
+void _pcf8576_fixed_to_digits(int32_t mantissa, uint8_t decimals,
+                              uint8_t flags, uint8_t digits[],
+                              size_t no_digits);
+uint32_t _pcf8576_float_key(float value);
+
+#endif /* ZEPHYR_INCLUDE_DISPLAY_PCF8576_CORE_H_ */
@@ -0,0 +1,245 @@
+/*
+* Copyright (c) 2022 Karoly Molnar
+*
+* SPDX-License-Identifier: Apache-2.0
+ */
+
+#define DT_DRV_COMPAT nxp_pcf8576
+
+#include <zephyr/device.h>
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/drivers/i2c_emul.h>
+#include <zephyr/kernel.h>
+
+#include "pcf8576.h"
+#include "pcf8576_emul.h"
+#include <errno.h>
+#include <string.h>
+
+#define LOG_LEVEL CONFIG_LCD_LOG_LEVEL
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(pcf8576_emul);
+
+#define PCF8576_CMD_CONTINUE 0x80
+
+/* command opcodes after the continuation bit is removed */
+#define PCF8576_EMUL_IS_LOAD_DP(c) (((c)&0x40) == 0x00)
+#define PCF8576_EMUL_IS_MODE_SET(c) (((c)&0x60) == 0x40)
+#define PCF8576_EMUL_IS_DEVICE_SELECT(c) (((c)&0x78) == 0x60)
+#define PCF8576_EMUL_IS_BLINK(c) (((c)&0x78) == 0x70)
+#define PCF8576_EMUL_IS_BANK_SELECT(c) (((c)&0x7c) == 0x78)
+
+/* I2C bit times of the address/data bytes (8 bits + ACK) and START/STOP */
+#define I2C_BITS_PER_BYTE 9
+#define I2C_BITS_START_STOP 2
+
+struct pcf8576_emul_cfg {
+  uint8_t mux;
+  uint8_t sub_address;
+  uint8_t devices;
+  uint32_t bitrate;
+};
+
+struct pcf8576_emul_data {
+  /* RAM of every device: one byte per column, bit n is row n */
+  uint8_t ram[PCF8576_MAX_DEVICES][PCF8576_COLUMNS];
+  uint8_t mode;
+  uint8_t blink;
+  uint8_t bank;
+  uint8_t data_pointer;
+  uint8_t subaddress_counter;
+  struct pcf8576_emul_stats stats;
+  pcf8576_emul_transfer_hook_t hook;
+  void *hook_user_data;
+};
+
+static void _pcf8576_emul_command(const struct pcf8576_emul_cfg *cfg,
+                                  struct pcf8576_emul_data *data,
+                                  uint8_t cmd) {
+  cmd &= ~PCF8576_CMD_CONTINUE;
+  if (PCF8576_EMUL_IS_LOAD_DP(cmd)) {
+    data->data_pointer = cmd & 0x3f;
+  } else if (PCF8576_EMUL_IS_MODE_SET(cmd)) {
+    data->mode = cmd & 0x1f;
+  } else if (PCF8576_EMUL_IS_DEVICE_SELECT(cmd)) {
+    data->subaddress_counter = cmd & 0x07;
+  } else if (PCF8576_EMUL_IS_BLINK(cmd)) {
+    data->blink = cmd & 0x07;
+  } else if (PCF8576_EMUL_IS_BANK_SELECT(cmd)) {
+    data->bank = cmd & 0x03;
+  } else {
+    LOG_WRN("unknown command 0x%02x", cmd);
+  }
+}
+
+static void _pcf8576_emul_store_bit(const struct pcf8576_emul_cfg *cfg,
+                                    struct pcf8576_emul_data *data,
+                                    uint8_t column, uint8_t row, bool on) {
+  uint8_t device = data->subaddress_counter - cfg->sub_address;
+
+  /* only the device whose sub-address matches the counter stores data */
+  if (data->subaddress_counter < cfg->sub_address || device >= cfg->devices ||
+      column >= PCF8576_COLUMNS) {
+    return;
+  }
+  /* in static and 1:2 drive mode the input bank selects rows 2/3 */
+  if (cfg->mux <= 2 && (data->bank & 0x02)) {
+    row += 2;
+  }
+  WRITE_BIT(data->ram[device][column], row, on);
+}
+
+static void _pcf8576_emul_store(const struct pcf8576_emul_cfg *cfg,
+                                struct pcf8576_emul_data *data,
+                                uint8_t byte) {
+  /* the bits are distributed MSB first over consecutive columns, mux bits
+   * per column; in 1:3 mode the last bit of the third column is not
+   * written */
+  uint8_t columns = (cfg->mux == 3) ? 3 : 8 / cfg->mux;
+
+  for (uint8_t bit = 0; bit < 8; bit++) {
+    uint8_t column = bit / cfg->mux;
+    uint8_t row = bit % cfg->mux;
+
+    _pcf8576_emul_store_bit(cfg, data, data->data_pointer + column, row,
+                            byte & BIT(7 - bit));
+  }
+  data->data_pointer += columns;
+  if (data->data_pointer >= PCF8576_COLUMNS) {
+    /* continue in the next device of the cascade */
+    data->data_pointer = 0;
+    data->subaddress_counter = (data->subaddress_counter + 1) & 0x07;
+  }
+}
+
+static int pcf8576_emul_transfer(const struct emul *target,
+                                 struct i2c_msg *msgs, int num_msgs,
+                                 int addr) {
+  const struct pcf8576_emul_cfg *cfg = target->cfg;
+  struct pcf8576_emul_data *data = target->data;
+  bool command = true;
+  bool last_command = false;
+  uint32_t bytes = 1; /* address */
+
+  if (data->hook != NULL) {
+    int ret = data->hook(target, msgs, num_msgs, data->hook_user_data);
+
+    if (ret) {
+      return ret;
+    }
+  }
+  for (int idx = 0; idx < num_msgs; idx++) {
+    if (msgs[idx].flags & I2C_MSG_READ) {
+      return -EIO; /* the device is write only */
+    }
+    if (idx > 0 && (msgs[idx].flags & I2C_MSG_RESTART)) {
+      /* a repeated START begins a new command sequence */
+      bytes++;
+      command = true;
+      last_command = false;
+    }
+    for (uint32_t pos = 0; pos < msgs[idx].len; pos++) {
+      uint8_t byte = msgs[idx].buf[pos];
+
+      if (command) {
+        _pcf8576_emul_command(cfg, data, byte);
+        last_command = !(byte & PCF8576_CMD_CONTINUE);
+        command = !last_command;
+      } else {
+        _pcf8576_emul_store(cfg, data, byte);
+        data->stats.data_bytes++;
+      }
+    }
+    bytes += msgs[idx].len;
+  }
+
+  data->stats.transactions++;
+  data->stats.bytes += bytes;
+  data->stats.wire_time_ns +=
+      (uint64_t)(bytes * I2C_BITS_PER_BYTE + I2C_BITS_START_STOP) *
+      NSEC_PER_SEC / cfg->bitrate;
+  return 0;
+}
+
+bool pcf8576_emul_get_bank_segment(const struct emul *target, uint8_t bank,
+                                   uint8_t backplane, uint16_t column) {
+  const struct pcf8576_emul_cfg *cfg = target->cfg;
+  struct pcf8576_emul_data *data = target->data;
+  uint16_t device = column / PCF8576_COLUMNS;
+
+  if (device >= cfg->devices || backplane >= cfg->mux) {
+    return false;
+  }
+  /* in static and 1:2 drive mode bank 1 is held in rows 2/3 */
+  if (cfg->mux <= 2 && bank) {
+    backplane += 2;
+  }
+  return data->ram[device][column % PCF8576_COLUMNS] & BIT(backplane);
+}
+
+bool pcf8576_emul_get_segment(const struct emul *target, uint8_t backplane,
+                              uint16_t column) {
+  struct pcf8576_emul_data *data = target->data;
+
+  return pcf8576_emul_get_bank_segment(target, data->bank & 0x01, backplane,
+                                       column);
+}
+
+uint8_t pcf8576_emul_get_mode(const struct emul *target) {
+  return ((struct pcf8576_emul_data *)target->data)->mode;
+}
+
+uint8_t pcf8576_emul_get_blink(const struct emul *target) {
+  return ((struct pcf8576_emul_data *)target->data)->blink;
+}
+
+uint8_t pcf8576_emul_get_bank(const struct emul *target) {
+  return ((struct pcf8576_emul_data *)target->data)->bank;
+}
+
+void pcf8576_emul_get_stats(const struct emul *target,
+                            struct pcf8576_emul_stats *stats) {
+  *stats = ((struct pcf8576_emul_data *)target->data)->stats;
+}
+
+void pcf8576_emul_set_transfer_hook(const struct emul *target,
+                                    pcf8576_emul_transfer_hook_t hook,
+                                    void *user_data) {
+  struct pcf8576_emul_data *data = target->data;
+
+  data->hook = hook;
+  data->hook_user_data = user_data;
+}
+
+void pcf8576_emul_reset_stats(const struct emul *target) {
+  struct pcf8576_emul_data *data = target->data;
+
+  memset(&data->stats, 0, sizeof(data->stats));
+}
+
+static int pcf8576_emul_init(const struct emul *target,
+                             const struct device *parent) {
+  struct pcf8576_emul_data *data = target->data;
+
+  memset(data, 0, sizeof(*data));
+  /* the RAM content is undefined after power-on */
+  memset(data->ram, 0xff, sizeof(data->ram));
+  return 0;
+}
+
+static const struct i2c_emul_api pcf8576_emul_api_i2c = {
+    .transfer = pcf8576_emul_transfer,
+};
+
+#define PCF8576_EMUL(n)                                                        \
+  static struct pcf8576_emul_data pcf8576_emul_data_##n;                       \
+  static const struct pcf8576_emul_cfg pcf8576_emul_cfg_##n = {                \
+      .mux = DT_INST_PROP(n, backplane_mux),                                   \
+      .sub_address = DT_INST_PROP(n, sub_address),                             \
+      .devices = DT_INST_PROP(n, cascade_devices),                             \
+      .bitrate = DT_PROP(DT_INST_BUS(n), clock_frequency)};                    \
+  EMUL_DT_INST_DEFINE(n, pcf8576_emul_init, &pcf8576_emul_data_##n,            \
+                      &pcf8576_emul_cfg_##n, &pcf8576_emul_api_i2c, NULL)
+
+DT_INST_FOREACH_STATUS_OKAY(PCF8576_EMUL)
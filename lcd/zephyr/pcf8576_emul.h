@@ -0,0 +1,74 @@
+/*
+* Copyright (c) 2022 Karoly Molnar
+*
+* SPDX-License-Identifier: Apache-2.0
+*/
+
+#ifndef ZEPHYR_INCLUDE_DISPLAY_PCF8576_EMUL_H_
+#define ZEPHYR_INCLUDE_DISPLAY_PCF8576_EMUL_H_
+
+#include <zephyr/drivers/emul.h>
+#include <zephyr/drivers/i2c.h>
+#include <zephyr/types.h>
+
+/**
+ * @brief Bus cost accounting of the PCF8576 emulator.
+ */
+struct pcf8576_emul_stats {
+  /* I2C transactions (START..STOP) addressed to the device */
+  uint32_t transactions;
+  /* bytes on the wire including the address bytes */
+  uint32_t bytes;
+  /* bytes stored in display RAM */
+  uint32_t data_bytes;
+  /* time on the wire at the bus' clock-frequency, in nanoseconds */
+  uint64_t wire_time_ns;
+};
+
+/**
+ * @brief Get the displayed state of a segment.
+ *
+ * @param backplane backplane (row) index 0..3
+ * @param column segment output, numbered contiguously over the cascade
+ */
+bool pcf8576_emul_get_segment(const struct emul *target, uint8_t backplane,
+                              uint16_t column);
+
+/**
+ * @brief Get the state of a segment in a RAM bank, shown or not.
+ *
+ * Bank 1 only exists in static and 1:2 drive mode.
+ */
+bool pcf8576_emul_get_bank_segment(const struct emul *target, uint8_t bank,
+                                   uint8_t backplane, uint16_t column);
+
+/** @brief Last MODE SET command parameters (lower 5 bits). */
+uint8_t pcf8576_emul_get_mode(const struct emul *target);
+
+/** @brief Last BLINK command parameters (lower 3 bits). */
+uint8_t pcf8576_emul_get_blink(const struct emul *target);
+
+/** @brief Last BANK SELECT command parameters (lower 2 bits). */
+uint8_t pcf8576_emul_get_bank(const struct emul *target);
+
+/**
+ * @brief Called with every transaction addressed to the emulator, before it
+ * is decoded.
+ *
+ * @return 0 to process the transaction, otherwise the error the transfer
+ * fails with.
+ */
+typedef int (*pcf8576_emul_transfer_hook_t)(const struct emul *target,
+                                            const struct i2c_msg *msgs,
+                                            int num_msgs, void *user_data);
+
+/** @brief Install a transfer hook, NULL removes it. */
+void pcf8576_emul_set_transfer_hook(const struct emul *target,
+                                    pcf8576_emul_transfer_hook_t hook,
+                                    void *user_data);
+
+void pcf8576_emul_get_stats(const struct emul *target,
+                            struct pcf8576_emul_stats *stats);
+void pcf8576_emul_reset_stats(const struct emul *target);
+
+#endif /* ZEPHYR_INCLUDE_DISPLAY_PCF8576_EMUL_H_ */
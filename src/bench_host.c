@@ -0,0 +1,20 @@
+/*
+* Copyright (c) 2022 Karoly Molnar
+* SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Host clock for the benchmarks on native_sim. This file is built into the
+ * native simulator runner, outside of the Zephyr image, and uses the host C
+ * library.
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+uint64_t lcd_bench_host_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
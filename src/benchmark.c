@@ -0,0 +1,234 @@
+/*
+* Copyright (c) 2022 Karoly Molnar
+* SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * Render and flush benchmarks. Every result is printed as one CSV line:
+ *
+ * BENCH,<operation>,<widget>,<pattern>,<calls>,<cycles/call>,<ns/call>,
+ *       <bytes/frame>,<wire us/frame>,<frames/s>
+ *
+ * The bus columns are only filled for flush operations and require the
+ * PCF8576 emulator; frames/s is derived from the wire time plus the CPU time
+ * of the flush call and is n/a when nothing was sent.
+ *
+ * The simulated clock of native_sim stands still while the CPU runs, so
+ * there the calls are timed with the host clock of the runner
+ * (src/bench_host.c) and cycles/call is n/a.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include <pcf8576.h>
+#include <zephyr/device.h>
+#if defined(CONFIG_EMUL_PCF8576)
+#include <pcf8576_emul.h>
+#endif
+
+#define LCD_DEV_NODELABEL DT_NODELABEL(lcd_drv)
+#define BENCH_CALLS 1000
+
+pcf8576_num_declare(num_small);
+pcf8576_num_declare(num_large);
+pcf8576_bar_declare(bar_battery);
+pcf8576_bar_declare(bar_antenna);
+
+#if defined(CONFIG_NATIVE_LIBRARY)
+/* implemented in src/bench_host.c, part of the native simulator runner */
+uint64_t lcd_bench_host_ns(void);
+
+typedef uint64_t bench_stamp_t;
+#define BENCH_STAMP() lcd_bench_host_ns()
+#define BENCH_STAMP_NS(elapsed) (elapsed)
+#else
+typedef uint32_t bench_stamp_t;
+#define BENCH_STAMP() k_cycle_get_32()
+#define BENCH_STAMP_NS(elapsed) k_cyc_to_ns_floor64(elapsed)
+#endif
+
+struct bench_result {
+  uint32_t calls;
+  /* host ns on native_sim, cycles otherwise */
+  uint64_t elapsed;
+  uint32_t bytes;
+  uint64_t wire_ns;
+};
+
+static const struct device *bench_dev(void) {
+  return DEVICE_DT_GET(LCD_DEV_NODELABEL);
+}
+
+static void bench_bus_reset(void) {
+#if defined(CONFIG_EMUL_PCF8576)
+  pcf8576_emul_reset_stats(EMUL_DT_GET(LCD_DEV_NODELABEL));
+#endif
+}
+
+static void bench_bus_collect(struct bench_result *res) {
+#if defined(CONFIG_EMUL_PCF8576)
+  struct pcf8576_emul_stats stats;
+
+  pcf8576_emul_get_stats(EMUL_DT_GET(LCD_DEV_NODELABEL), &stats);
+  res->bytes = stats.bytes;
+  res->wire_ns = stats.wire_time_ns;
+#endif
+}
+
+static void bench_report(const char *op, const char *widget,
+                         const char *pattern, const struct bench_result *res) {
+  uint64_t ns = BENCH_STAMP_NS(res->elapsed);
+  uint32_t ns_per_call = (uint32_t)(ns / res->calls);
+  uint32_t bytes_per_frame = res->bytes / res->calls;
+  uint32_t wire_us = (uint32_t)(res->wire_ns / res->calls / 1000);
+  uint64_t frame_ns = (res->wire_ns + ns) / res->calls;
+  char cycles_per_call[11] = "n/a";
+  char fps[11] = "n/a";
+
+  if (!IS_ENABLED(CONFIG_NATIVE_LIBRARY)) {
+    snprintk(cycles_per_call, sizeof(cycles_per_call), "%u",
+             (uint32_t)(res->elapsed / res->calls));
+  }
+  if (res->wire_ns) {
+    snprintk(fps, sizeof(fps), "%u", (uint32_t)(NSEC_PER_SEC / frame_ns));
+  }
+
+  TC_PRINT("BENCH,%s,%s,%s,%u,%s,%u,%u,%u,%s\n", op, widget, pattern,
+           res->calls, cycles_per_call, ns_per_call, bytes_per_frame, wire_us,
+           fps);
+}
+
+/* times BENCH_CALLS evaluations of stmt, i is the iteration index */
+#define BENCH_RUN(res, stmt)                                                   \
+  do {                                                                         \
+    bench_stamp_t start = BENCH_STAMP();                                       \
+    for (uint32_t i = 0; i < BENCH_CALLS; i++) {                               \
+      stmt;                                                                    \
+    }                                                                          \
+    (res)->elapsed += (bench_stamp_t)(BENCH_STAMP() - start);                  \
+    (res)->calls += BENCH_CALLS;                                               \
+  } while (0)
+
+static void bench_setup(void *fixture) {
+  ARG_UNUSED(fixture);
+  TC_PRINT("BENCH,operation,widget,pattern,calls,cycles_per_call,ns_per_call,"
+           "bytes_per_frame,wire_us_per_frame,fps\n");
+}
+
+ZTEST_SUITE(lcd_bench, NULL, NULL, bench_setup, NULL, NULL);
+
+ZTEST(lcd_bench, test_num_int)
+{
+  const struct device *dev = bench_dev();
+  struct bench_result res;
+
+  /* constant, slowly and fast changing values */
+  res = (struct bench_result){0};
+  BENCH_RUN(&res, pcf8576_num_int(dev, num_small, 1234));
+  bench_report("num_int", "num_small", "constant", &res);
+
+  res = (struct bench_result){0};
+  BENCH_RUN(&res, pcf8576_num_int(dev, num_small, i));
+  bench_report("num_int", "num_small", "count", &res);
+
+  res = (struct bench_result){0};
+  BENCH_RUN(&res, pcf8576_num_int(dev, num_large, i * 7919 - 499999));
+  bench_report("num_int", "num_large", "sweep", &res);
+}
+
+ZTEST(lcd_bench, test_num_fixed)
+{
+  const struct device *dev = bench_dev();
+  struct bench_result res = {0};
+
+  BENCH_RUN(&res, pcf8576_num_fixed(dev, num_large, i * 7919 - 499999, 3));
+  bench_report("num_fixed", "num_large", "sweep", &res);
+}
+
+ZTEST(lcd_bench, test_num_float)
+{
+  const struct device *dev = bench_dev();
+  struct bench_result res;
+
+  res = (struct bench_result){0};
+  BENCH_RUN(&res, pcf8576_num(dev, num_small, (float)i));
+  bench_report("num", "num_small", "count", &res);
+
+  res = (struct bench_result){0};
+  BENCH_RUN(&res, pcf8576_num(dev, num_large, i * 1.07f - 500.f));
+  bench_report("num", "num_large", "sweep", &res);
+}
+
+ZTEST(lcd_bench, test_bar)
+{
+  const struct device *dev = bench_dev();
+  size_t battery = PCF8576_WIDGET_SIZE(bar_battery);
+  size_t antenna = PCF8576_WIDGET_SIZE(bar_antenna);
+  struct bench_result res;
+
+  res = (struct bench_result){0};
+  BENCH_RUN(&res, pcf8576_bar(dev, bar_battery, battery));
+  bench_report("bar", "bar_battery", "constant", &res);
+
+  res = (struct bench_result){0};
+  BENCH_RUN(&res, pcf8576_bar(dev, bar_battery, 1 + i % battery));
+  bench_report("bar", "bar_battery", "sweep", &res);
+
+  res = (struct bench_result){0};
+  BENCH_RUN(&res, pcf8576_bar(dev, bar_antenna, 1 + i % antenna));
+  bench_report("bar", "bar_antenna", "sweep", &res);
+}
+
+ZTEST(lcd_bench, test_sign)
+{
+  const struct device *dev = bench_dev();
+  struct bench_result res = {0};
+
+  BENCH_RUN(&res, pcf8576_sign(dev, sign_repair, i & 1));
+  bench_report("sign", "sign_repair", "toggle", &res);
+}
+
+ZTEST(lcd_bench, test_flush)
+{
+  const struct device *dev = bench_dev();
+  struct bench_result res;
+
+  /* make sure the patterns start from a known frame */
+  pcf8576_flush(dev);
+
+  res = (struct bench_result){0};
+  bench_bus_reset();
+  BENCH_RUN(&res, pcf8576_flush(dev));
+  bench_bus_collect(&res);
+  bench_report("flush", "all", "unchanged", &res);
+
+  res = (struct bench_result){0};
+  bench_bus_reset();
+  BENCH_RUN(&res, {
+    pcf8576_sign(dev, sign_repair, i & 1);
+    pcf8576_flush(dev);
+  });
+  bench_bus_collect(&res);
+  bench_report("flush", "sign_repair", "toggle", &res);
+
+  res = (struct bench_result){0};
+  bench_bus_reset();
+  BENCH_RUN(&res, {
+    pcf8576_num_int(dev, num_small, i);
+    pcf8576_flush(dev);
+  });
+  bench_bus_collect(&res);
+  bench_report("flush", "num_small", "count", &res);
+
+  res = (struct bench_result){0};
+  bench_bus_reset();
+  BENCH_RUN(&res, {
+    pcf8576_num_int(dev, num_small, (i & 1) ? 8888 : -888);
+    pcf8576_num_int(dev, num_large, (i & 1) ? 888888 : -88888);
+    pcf8576_bar(dev, bar_battery, (i & 1) ? 5 : 1);
+    pcf8576_flush(dev);
+  });
+  bench_bus_collect(&res);
+  bench_report("flush", "all", "alternate", &res);
+}
@@ -5,6 +5,7 @@
 
 #include <zephyr/kernel.h>
 
+#include <lcd.h>
 #include <pcf8576.h>
 #include <zephyr/device.h>
 #include <zephyr/logging/log.h>
@@ -12,6 +13,18 @@
 #include <zephyr/ztest.h>
 #include <string.h>
 #endif
+#if defined(CONFIG_EMUL_PCF8576)
+#include <pcf8576_emul.h>
+#endif
+#if defined(CONFIG_PM_DEVICE)
+#include <zephyr/pm/device.h>
+#endif
+#if defined(CONFIG_PCF8576_STATS)
+#include <zephyr/stats/stats.h>
+#endif
+#if defined(CONFIG_USERSPACE) && defined(CONFIG_ZTEST)
+#include <zephyr/ztest_error_hook.h>
+#endif
 LOG_MODULE_REGISTER(lcdtest);
 
 #define LCD_DEV_NODELABEL DT_NODELABEL(lcd_drv)
@@ -49,7 +62,7 @@ void main(void) {
   int counsmall = 999;
   while (1) {
     pcf8576_num(dev, num_large, countlarge);
-    pcf8576_num(dev, num_small, (double)counsmall--);
+    pcf8576_num_int(dev, num_small, counsmall--);
     countlarge = countlarge + 1.07;
     pcf8576_flush(dev);
     k_msleep(100);
@@ -226,4 +239,1239 @@ ZTEST(lcd_tests, test_large_num_ovf)
 
 }
 
+ZTEST(lcd_tests, test_large_num_int)
+{
+  const struct device *dev = DEVICE_DT_GET(LCD_DEV_NODELABEL);
+  pcf8576_num_int(dev, num_large, -1984);
+  uint8_t ref[6] = {30,10,1,9,8,4};
+  zassert_mem_equal(digitarray_num_large, ref, 6, "Mismatch in LCD values");
+
+  pcf8576_num_int(dev, num_large, 0);
+  uint8_t ref_zero[6] = {30,30,30,30,30,0};
+  zassert_mem_equal(digitarray_num_large, ref_zero, 6, "Mismatch in LCD values");
+
+  pcf8576_num_fixed_opt(dev, num_large, -42, 0, PCF8576_NUM_LEADING_ZEROS);
+  uint8_t ref_lz[6] = {10,0,0,0,4,2};
+  zassert_mem_equal(digitarray_num_large, ref_lz, 6, "Mismatch in LCD values");
+
+  pcf8576_num_int(dev, num_large, 1234567);
+  uint8_t ref_ovf[6] = {10,10,10,10,10,10};
+  zassert_mem_equal(digitarray_num_large, ref_ovf, 6, "Mismatch in LCD values");
+}
+
+ZTEST(lcd_tests, test_large_num_fixed)
+{
+  const struct device *dev = DEVICE_DT_GET(LCD_DEV_NODELABEL);
+  pcf8576_num_fixed(dev, num_large, 1200, 2);
+  uint8_t ref[6] = {30,30,30,30,1,2};
+  zassert_mem_equal(digitarray_num_large, ref, 6, "Mismatch in LCD values");
+
+  pcf8576_num_fixed_opt(dev, num_large, 1200, 2, PCF8576_NUM_FIXED_DP);
+  uint8_t ref_dp[6] = {30,30,1,22,0,0};
+  zassert_mem_equal(digitarray_num_large, ref_dp, 6, "Mismatch in LCD values");
+
+  pcf8576_num_fixed(dev, num_large, -7, 3);
+  uint8_t ref_neg[6] = {30,10,20,0,0,7};
+  zassert_mem_equal(digitarray_num_large, ref_neg, 6, "Mismatch in LCD values");
+
+  /* rounded to the number of digits available */
+  pcf8576_num_fixed(dev, num_large, 123456789, 3);
+  uint8_t ref_rnd[6] = {1,2,3,4,5,7};
+  zassert_mem_equal(digitarray_num_large, ref_rnd, 6, "Mismatch in LCD values");
+
+  /* rounded once from the original value, not digit by digit */
+  pcf8576_num_fixed(dev, num_large, -9999949, 4);
+  uint8_t ref_rnd_once[6] = {10,9,9,29,9,9};
+  zassert_mem_equal(digitarray_num_large, ref_rnd_once, 6, "Mismatch in LCD values");
+
+  /* a value rounded to zero does not keep a digit for the sign */
+  pcf8576_num_fixed_opt(dev, num_large, -4, 6, PCF8576_NUM_FIXED_DP);
+  uint8_t ref_zero[6] = {20,0,0,0,0,0};
+  zassert_mem_equal(digitarray_num_large, ref_zero, 6, "Mismatch in LCD values");
+}
+
+#if defined(CONFIG_EMUL_PCF8576)
+ZTEST(lcd_tests, test_emul_sign)
+{
+  const struct device *dev = DEVICE_DT_GET(LCD_DEV_NODELABEL);
+  const struct emul *emul = EMUL_DT_GET(LCD_DEV_NODELABEL);
+  struct pcf8576_emul_stats stats;
+
+  pcf8576_sign(dev, sign_repair, false);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  zassert_false(pcf8576_emul_get_segment(emul, 2, 8), "segment is on");
+
+  pcf8576_emul_reset_stats(emul);
+  pcf8576_sign(dev, sign_repair, true);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  zassert_true(pcf8576_emul_get_segment(emul, 2, 8), "segment is off");
+
+  /* address, LOAD DATA POINTER, DEVICE SELECT and the single changed byte */
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 1, "unexpected transaction count");
+  zassert_equal(stats.bytes, 4, "unexpected byte count");
+  TC_PRINT("sign update: %u bytes, %u ns on the wire\n", stats.bytes,
+           (uint32_t)stats.wire_time_ns);
+
+  /* unchanged frame is not sent */
+  pcf8576_emul_reset_stats(emul);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 0, "unchanged frame was sent");
+}
+
+#if defined(CONFIG_PCF8576_STATS)
+struct stat_query {
+  const char *name;
+  uint32_t value;
+};
+
+static int stat_match(struct stats_hdr *hdr, void *arg, const char *name,
+                      uint16_t off)
+{
+  struct stat_query *query = arg;
+
+  if (strcmp(name, query->name) == 0) {
+    query->value = *(uint32_t *)((uint8_t *)hdr + off);
+  }
+  return 0;
+}
+
+static uint32_t stat_get(const struct device *dev, const char *name)
+{
+  struct stats_hdr *hdr = stats_group_find(dev->name);
+  struct stat_query query = {.name = name};
+
+  zassert_not_null(hdr, "statistics are not registered");
+  stats_walk(hdr, stat_match, &query);
+  return query.value;
+}
+
+static uint32_t stat_lat_total(const struct device *dev)
+{
+  static const char *const names[] = {
+      "lat_lt_128us", "lat_lt_256us", "lat_lt_512us", "lat_lt_1ms",
+      "lat_lt_2ms",   "lat_lt_4ms",   "lat_lt_8ms",   "lat_ge_8ms"};
+  uint32_t total = 0;
+
+  for (size_t idx = 0; idx < ARRAY_SIZE(names); idx++) {
+    total += stat_get(dev, names[idx]);
+  }
+  return total;
+}
+
+ZTEST(lcd_tests, test_emul_stats)
+{
+  const struct device *dev = DEVICE_DT_GET(LCD_DEV_NODELABEL);
+  const struct emul *emul = EMUL_DT_GET(LCD_DEV_NODELABEL);
+  struct pcf8576_emul_stats stats;
+
+  pcf8576_sign(dev, sign_repair, false);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+
+  uint32_t flushes = stat_get(dev, "flushes");
+  uint32_t bytes = stat_get(dev, "bytes");
+  uint32_t skipped = stat_get(dev, "skipped");
+  uint32_t lat = stat_lat_total(dev);
+
+  pcf8576_emul_reset_stats(emul);
+  pcf8576_sign(dev, sign_repair, true);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  pcf8576_sign(dev, sign_repair, false);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  pcf8576_emul_get_stats(emul, &stats);
+
+  /* every transfer counts once in the histogram, the bytes exclude the
+   * address the emulator counts */
+  zassert_equal(stat_get(dev, "flushes") - flushes, 2, "flushes not counted");
+  zassert_equal(stat_lat_total(dev) - lat, 2, "latencies not counted");
+  zassert_equal(stat_get(dev, "bytes") - bytes,
+                stats.bytes - stats.transactions, "bytes not counted");
+  zassert_equal(stat_get(dev, "skipped"), skipped, "sent flush skipped");
+
+  /* a flush without changes only counts as skipped */
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  zassert_equal(stat_get(dev, "flushes") - flushes, 2, "empty flush counted");
+  zassert_equal(stat_get(dev, "skipped") - skipped, 1, "skip not counted");
+}
+#endif
+
+#if defined(CONFIG_PCF8576_TRACING) && defined(CONFIG_TRACING_USER)
+enum {
+  TRACE_RENDER_START,
+  TRACE_RENDER_END,
+  TRACE_FLUSH_START,
+  TRACE_FLUSH_END,
+  TRACE_I2C_ERROR,
+  TRACE_EVENTS,
+};
+
+static const char *const trace_names[TRACE_EVENTS] = {
+    "lcd_render_start", "lcd_render_end", "lcd_flush_start",
+    "lcd_flush_end",    "lcd_i2c_error",
+};
+
+struct trace_log {
+  uint32_t count[TRACE_EVENTS];
+  uint32_t arg0[TRACE_EVENTS];
+  uint32_t arg1[TRACE_EVENTS];
+};
+
+static struct trace_log trace_log;
+
+void pcf8576_trace_user(const char *name, uint32_t arg0, uint32_t arg1)
+{
+  for (size_t event = 0; event < TRACE_EVENTS; event++) {
+    if (strcmp(name, trace_names[event]) == 0) {
+      trace_log.count[event]++;
+      trace_log.arg0[event] = arg0;
+      trace_log.arg1[event] = arg1;
+    }
+  }
+}
+
+static int trace_fail_hook(const struct emul *target,
+                           const struct i2c_msg *msgs, int num_msgs,
+                           void *user_data)
+{
+  return -EIO;
+}
+
+ZTEST(lcd_tests, test_emul_tracing)
+{
+  const struct device *dev = DEVICE_DT_GET(LCD_DEV_NODELABEL);
+  const struct emul *emul = EMUL_DT_GET(LCD_DEV_NODELABEL);
+
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+
+  /* a render is enclosed by start and end, naming the widget */
+  trace_log = (struct trace_log){0};
+  pcf8576_num_int(dev, num_small, 42);
+  zassert_equal(trace_log.count[TRACE_RENDER_START], 1, "no render start");
+  zassert_equal(trace_log.count[TRACE_RENDER_END], 1, "no render end");
+  zassert_equal(trace_log.arg0[TRACE_RENDER_END], PCF8576_TRACE_NUM,
+                "unexpected widget kind");
+  zassert_equal(trace_log.arg1[TRACE_RENDER_END],
+                (uint32_t)(uintptr_t)&nummemo_num_small,
+                "unexpected widget");
+
+  /* a flush is enclosed by start and end, the end carries the result */
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  zassert_equal(trace_log.count[TRACE_FLUSH_START], 1, "no flush start");
+  zassert_equal(trace_log.count[TRACE_FLUSH_END], 1, "no flush end");
+  zassert_equal(trace_log.arg0[TRACE_FLUSH_START],
+                trace_log.arg0[TRACE_FLUSH_END], "unexpected byte count");
+  zassert_equal(trace_log.arg1[TRACE_FLUSH_END], 0, "unexpected result");
+  zassert_equal(trace_log.count[TRACE_I2C_ERROR], 0, "unexpected error");
+
+  /* a failed transfer is reported with its errno */
+  pcf8576_emul_set_transfer_hook(emul, trace_fail_hook, NULL);
+  pcf8576_num_int(dev, num_small, 43);
+  zassert_not_ok(pcf8576_flush(dev), "failed flush succeeded");
+  pcf8576_emul_set_transfer_hook(emul, NULL, NULL);
+  zassert_equal(trace_log.count[TRACE_I2C_ERROR], 1, "no error event");
+  zassert_equal(trace_log.arg0[TRACE_I2C_ERROR], EIO, "unexpected errno");
+  zassert_equal(trace_log.arg1[TRACE_FLUSH_END], EIO, "unexpected result");
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+}
+#endif
+
+ZTEST(lcd_tests, test_emul_number)
+{
+  const struct device *dev = DEVICE_DT_GET(LCD_DEV_NODELABEL);
+  const struct emul *emul = EMUL_DT_GET(LCD_DEV_NODELABEL);
+  struct pcf8576_emul_stats stats;
+
+  pcf8576_num_int(dev, num_small, 1);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  /* digit 4 shows "1": segments b and c on, a off */
+  zassert_true(pcf8576_emul_get_segment(emul, 2, 7), "segment 4b is off");
+  zassert_true(pcf8576_emul_get_segment(emul, 1, 7), "segment 4c is off");
+  zassert_false(pcf8576_emul_get_segment(emul, 3, 7), "segment 4a is on");
+  /* leading digits are blank */
+  zassert_false(pcf8576_emul_get_segment(emul, 2, 1), "segment 1b is on");
+
+  pcf8576_emul_reset_stats(emul);
+  pcf8576_num_int(dev, num_large, 123456);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  TC_PRINT("num_large frame: %u bytes, %u ns on the wire\n", stats.bytes,
+           (uint32_t)stats.wire_time_ns);
+  zassert_equal(stats.transactions, 1, "unexpected transaction count");
+}
+
+ZTEST(lcd_tests, test_emul_memo)
+{
+  const struct device *dev = DEVICE_DT_GET(LCD_DEV_NODELABEL);
+  const struct emul *emul = EMUL_DT_GET(LCD_DEV_NODELABEL);
+  struct pcf8576_emul_stats stats;
+
+  pcf8576_num_int(dev, num_small, 1234);
+  pcf8576_bar(dev, bar_battery, 3);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+
+  /* unchanged values leave the RAM mirror alone */
+  pcf8576_emul_reset_stats(emul);
+  pcf8576_num_int(dev, num_small, 1234);
+  pcf8576_bar(dev, bar_battery, 3);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 0, "unchanged widgets were sent");
+
+  /* only the last digit changes */
+  pcf8576_num_int(dev, num_small, 1235);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.data_bytes, 1, "more than one digit was sent");
+
+  /* an empty bar clears every level, the first one is seg_w1 <3 8> */
+  zassert_true(pcf8576_emul_get_segment(emul, 3, 8), "bar level 1 is off");
+  pcf8576_bar(dev, bar_battery, 0);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  zassert_false(pcf8576_emul_get_segment(emul, 3, 8), "bar level 1 is on");
+}
+
+ZTEST(lcd_tests, test_emul_bar)
+{
+  const struct device *dev = DEVICE_DT_GET(LCD_DEV_NODELABEL);
+  const struct emul *emul = EMUL_DT_GET(LCD_DEV_NODELABEL);
+  struct pcf8576_emul_stats stats;
+  struct lcd_segment_update updates[8];
+  struct pcf8576_batch batch;
+  const int full = PCF8576_WIDGET_SIZE(bar_battery);
+
+  /* the full level lights every segment, seg_w2 <3 9> is the last */
+  zassert_ok(pcf8576_bar(dev, bar_battery, full), "full level rejected");
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  zassert_true(pcf8576_emul_get_segment(emul, 3, 9), "bar level 5 is off");
+
+  /* levels out of range leave the bar as it is */
+  pcf8576_emul_reset_stats(emul);
+  zassert_equal(pcf8576_bar(dev, bar_battery, -1), -EINVAL,
+                "negative level accepted");
+  zassert_equal(pcf8576_bar(dev, bar_battery, full + 1), -EINVAL,
+                "level above the bar accepted");
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 0, "rejected level was sent");
+  zassert_true(pcf8576_emul_get_segment(emul, 3, 8), "bar level 1 is off");
+  zassert_true(pcf8576_emul_get_segment(emul, 3, 9), "bar level 5 is off");
+
+  pcf8576_batch_init(&batch, updates, ARRAY_SIZE(updates));
+  zassert_equal(pcf8576_batch_bar(&batch, bar_battery, -1), -EINVAL,
+                "negative level accepted");
+  zassert_equal(pcf8576_batch_bar(&batch, bar_battery, full + 1), -EINVAL,
+                "level above the bar accepted");
+  zassert_equal(batch.count, 0, "rejected level was batched");
+
+  /* the whole battery bar lives in one RAM byte */
+  pcf8576_emul_reset_stats(emul);
+  pcf8576_bar(dev, bar_battery, 2);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.data_bytes, 1, "more than one byte was sent");
+  zassert_true(pcf8576_emul_get_segment(emul, 0, 9), "bar level 2 is off");
+  zassert_false(pcf8576_emul_get_segment(emul, 1, 9), "bar level 3 is on");
+  zassert_false(pcf8576_emul_get_segment(emul, 3, 9), "bar level 5 is on");
+}
+
+ZTEST(lcd_tests, test_emul_frame)
+{
+  const struct device *dev = DEVICE_DT_GET(LCD_DEV_NODELABEL);
+  const struct emul *emul = EMUL_DT_GET(LCD_DEV_NODELABEL);
+  struct pcf8576_emul_stats stats;
+
+  pcf8576_sign(dev, sign_repair, false);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+
+  /* nothing is sent while the frame is open */
+  pcf8576_emul_reset_stats(emul);
+  pcf8576_frame_begin(dev);
+  pcf8576_sign_toggle(dev, sign_repair);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 0, "flushed inside a frame");
+  zassert_false(pcf8576_emul_get_segment(emul, 2, 8), "segment is on");
+
+  /* the deferred flush is performed by the commit */
+  zassert_ok(pcf8576_frame_commit(dev), "commit failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 1, "deferred flush not performed");
+  zassert_true(pcf8576_emul_get_segment(emul, 2, 8), "segment is off");
+
+  pcf8576_sign_toggle(dev, sign_repair);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  zassert_false(pcf8576_emul_get_segment(emul, 2, 8), "segment is on");
+}
+
+static int frame_race_hook(const struct emul *target,
+                           const struct i2c_msg *msgs, int num_msgs,
+                           void *user_data)
+{
+  const struct device *dev = user_data;
+  uint8_t value = PCF8576_SEG_MASK_MUX(4, 0, 39);
+
+  /* a frame is opened and half written while the flush is on the bus */
+  pcf8576_emul_set_transfer_hook(target, NULL, NULL);
+  pcf8576_frame_begin(dev);
+  pcf8576_sign(dev, sign_repair, false);
+  (void)lcd_write_segments(dev, &value, PCF8576_SEG_BYTE_MUX(4, 0, 39), 1);
+  return 0;
+}
+
+ZTEST(lcd_tests, test_emul_frame_race)
+{
+  const struct device *dev = DEVICE_DT_GET(LCD_DEV_NODELABEL);
+  const struct emul *emul = EMUL_DT_GET(LCD_DEV_NODELABEL);
+  struct pcf8576_emul_stats stats;
+  uint8_t value = 0;
+
+  pcf8576_sign(dev, sign_repair, false);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+
+  /* the running flush only carries the state from before the frame */
+  pcf8576_sign(dev, sign_repair, true);
+  pcf8576_emul_set_transfer_hook(emul, frame_race_hook, (void *)dev);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  zassert_true(pcf8576_emul_get_segment(emul, 2, 8), "sign is off");
+  zassert_false(pcf8576_emul_get_segment(emul, 0, 39), "segment 39 is on");
+
+  /* the open frame is not sent in parts */
+  pcf8576_emul_reset_stats(emul);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 0, "flushed inside a frame");
+
+  /* the commit sends the whole frame at once */
+  zassert_ok(pcf8576_frame_commit(dev), "commit failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 1, "frame not sent in one transaction");
+  zassert_false(pcf8576_emul_get_segment(emul, 2, 8), "sign is on");
+  zassert_true(pcf8576_emul_get_segment(emul, 0, 39), "segment 39 is off");
+
+  zassert_ok(lcd_write_segments(dev, &value, PCF8576_SEG_BYTE_MUX(4, 0, 39),
+                                1), "write failed");
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+}
+
+ZTEST(lcd_tests, test_emul_segments)
+{
+  const struct device *dev = DEVICE_DT_GET(LCD_DEV_NODELABEL);
+  const struct emul *emul = EMUL_DT_GET(LCD_DEV_NODELABEL);
+  struct pcf8576_emul_stats stats;
+  struct lcd_capabilities caps;
+  size_t byte = PCF8576_SEG_BYTE(2, 8);
+  uint8_t value;
+  uint8_t *fb;
+
+  zassert_ok(lcd_get_capabilities(dev, &caps), "no capabilities");
+  zassert_equal(caps.backplanes, 4, "unexpected backplanes");
+  zassert_equal(caps.segments, caps.ram_size * 2, "unexpected segments");
+  zassert_true(caps.flags & LCD_CAP_FRAMEBUFFER, "no framebuffer");
+  fb = lcd_get_framebuffer(dev);
+  zassert_not_null(fb, "no framebuffer");
+  zassert_equal(lcd_write_segments(dev, fb, 0, caps.ram_size + 1), -EINVAL,
+                "span outside the RAM accepted");
+
+  /* a copied span */
+  value = fb[byte] | PCF8576_SEG_MASK(2, 8);
+  zassert_ok(lcd_write_segments(dev, &value, byte, 1), "write failed");
+  zassert_ok(lcd_flush(dev), "flush failed");
+  zassert_true(pcf8576_emul_get_segment(emul, 2, 8), "segment is off");
+
+  /* rendered in place, only the span is sent */
+  pcf8576_emul_reset_stats(emul);
+  fb[byte] &= ~PCF8576_SEG_MASK(2, 8);
+  zassert_ok(lcd_write_segments(dev, &fb[byte], byte, 1), "write failed");
+  zassert_ok(lcd_flush(dev), "flush failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.data_bytes, 1, "more than the span was sent");
+  zassert_false(pcf8576_emul_get_segment(emul, 2, 8), "segment is on");
+}
+
+ZTEST(lcd_tests, test_emul_batch)
+{
+  const struct device *dev = DEVICE_DT_GET(LCD_DEV_NODELABEL);
+  const struct emul *emul = EMUL_DT_GET(LCD_DEV_NODELABEL);
+  struct lcd_segment_update updates[16];
+  struct lcd_segment_update outside = {.offset = 0xffff, .clear = 0xff};
+  struct pcf8576_batch batch;
+  struct pcf8576_emul_stats stats;
+
+  pcf8576_batch_init(&batch, updates, ARRAY_SIZE(updates));
+  pcf8576_batch_num_int(&batch, num_small, 1);
+  pcf8576_batch_bar(&batch, bar_battery, 2);
+  pcf8576_batch_sign(&batch, sign_repair, true);
+  /* the whole battery bar and seg_repair share one RAM byte */
+  zassert_true(batch.count < ARRAY_SIZE(updates), "batch overflowed");
+
+  pcf8576_emul_reset_stats(emul);
+  zassert_ok(pcf8576_batch_submit(dev, &batch, LCD_SUBMIT_FLUSH),
+             "submit failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 1, "unexpected transaction count");
+  zassert_equal(batch.count, 0, "batch not emptied");
+  /* digit 4 shows "1", leading digits are blank */
+  zassert_true(pcf8576_emul_get_segment(emul, 2, 7), "segment 4b is off");
+  zassert_true(pcf8576_emul_get_segment(emul, 1, 7), "segment 4c is off");
+  zassert_false(pcf8576_emul_get_segment(emul, 3, 7), "segment 4a is on");
+  zassert_false(pcf8576_emul_get_segment(emul, 2, 1), "segment 1b is on");
+  zassert_true(pcf8576_emul_get_segment(emul, 0, 9), "bar level 2 is off");
+  zassert_false(pcf8576_emul_get_segment(emul, 1, 9), "bar level 3 is on");
+  zassert_true(pcf8576_emul_get_segment(emul, 2, 8), "sign is off");
+
+  /* merged writes of the same byte, writes outside the RAM are ignored */
+  pcf8576_batch_sign(&batch, sign_repair, true);
+  pcf8576_batch_sign(&batch, sign_repair, false);
+  zassert_equal(batch.count, 1, "writes of one byte not merged");
+  batch.updates[batch.count++] = outside;
+  pcf8576_emul_reset_stats(emul);
+  zassert_ok(pcf8576_batch_submit(dev, &batch, LCD_SUBMIT_FLUSH),
+             "submit failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.data_bytes, 1, "more than one byte was sent");
+  zassert_false(pcf8576_emul_get_segment(emul, 2, 8), "sign is on");
+
+  /* an overflowed batch is dropped */
+  pcf8576_batch_init(&batch, updates, 1);
+  pcf8576_batch_num_int(&batch, num_small, 1234);
+  zassert_true(batch.overflow, "batch did not overflow");
+  zassert_equal(pcf8576_batch_submit(dev, &batch, 0), -ENOMEM,
+                "overflowed batch submitted");
+
+  /* the direct macros render these widgets in full again */
+  nummemo_num_small.dev = NULL;
+  barmemo_bar_battery.dev = NULL;
+}
+
+#ifdef CONFIG_USERSPACE
+#define USER_STACK_SIZE 2048
+/* values reported by the user thread, the last two by and after the
+ * faulting call */
+#define USER_REPORTS 7
+
+K_THREAD_STACK_DEFINE(user_stack, USER_STACK_SIZE);
+static struct k_thread user_thread;
+K_MSGQ_DEFINE(user_msgq, sizeof(int), USER_REPORTS, sizeof(int));
+/* not part of any memory domain, so the user thread may not read it */
+static uint8_t user_forbidden[4];
+
+static void user_report(int value)
+{
+  (void)k_msgq_put(&user_msgq, &value, K_NO_WAIT);
+}
+
+static void user_entry(void *p1, void *p2, void *p3)
+{
+  const struct device *dev = p1;
+  struct lcd_segment_update updates[16];
+  struct pcf8576_batch batch;
+  struct lcd_capabilities caps;
+  uint8_t value = PCF8576_SEG_MASK_MUX(4, 0, 39);
+
+  user_report(lcd_get_capabilities(dev, &caps));
+  user_report(caps.ram_size);
+
+  /* the widgets are rendered into the thread's own memory */
+  pcf8576_batch_init(&batch, updates, ARRAY_SIZE(updates));
+  pcf8576_batch_num_int(&batch, num_small, 1);
+  pcf8576_batch_bar(&batch, bar_battery, 2);
+  pcf8576_batch_sign(&batch, sign_repair, true);
+  user_report(pcf8576_batch_submit(dev, &batch, LCD_SUBMIT_FLUSH));
+
+  user_report(lcd_write_segments(dev, &value, PCF8576_SEG_BYTE_MUX(4, 0, 39),
+                                 1));
+  user_report(lcd_flush(dev));
+
+  /* a buffer the thread can't read faults it */
+  ztest_set_fault_valid(true);
+  user_report(lcd_write_segments(dev, user_forbidden, 0,
+                                 sizeof(user_forbidden)));
+  ztest_set_fault_valid(false);
+  user_report(0);
+}
+
+ZTEST(lcd_tests, test_emul_user)
+{
+  const struct device *dev = DEVICE_DT_GET(LCD_DEV_NODELABEL);
+  const struct emul *emul = EMUL_DT_GET(LCD_DEV_NODELABEL);
+  struct pcf8576_emul_stats stats;
+  int reports[USER_REPORTS];
+  int count = 0;
+
+  pcf8576_sign(dev, sign_repair, false);
+  pcf8576_bar(dev, bar_battery, 0);
+  pcf8576_num_int(dev, num_small, 8);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  pcf8576_emul_reset_stats(emul);
+  k_msgq_purge(&user_msgq);
+
+  k_thread_create(&user_thread, user_stack, USER_STACK_SIZE, user_entry,
+                  (void *)dev, NULL, NULL, K_PRIO_PREEMPT(1), K_USER,
+                  K_FOREVER);
+  k_object_access_grant(dev, &user_thread);
+  k_object_access_grant(&user_msgq, &user_thread);
+  k_thread_start(&user_thread);
+  zassert_ok(k_thread_join(&user_thread, K_SECONDS(5)), "thread hangs");
+
+  while (count < USER_REPORTS &&
+         k_msgq_get(&user_msgq, &reports[count], K_NO_WAIT) == 0) {
+    count++;
+  }
+  zassert_equal(count, USER_REPORTS - 2, "faulting call returned");
+  zassert_ok(reports[0], "capabilities failed");
+  zassert_equal(reports[1], 20, "unexpected RAM size");
+  zassert_ok(reports[2], "submit failed");
+  zassert_ok(reports[3], "write failed");
+  zassert_ok(reports[4], "flush failed");
+
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 2, "unexpected transaction count");
+  /* digit 4 shows "1", the bar level 2 and the sign */
+  zassert_true(pcf8576_emul_get_segment(emul, 2, 7), "segment 4b is off");
+  zassert_true(pcf8576_emul_get_segment(emul, 1, 7), "segment 4c is off");
+  zassert_true(pcf8576_emul_get_segment(emul, 0, 9), "bar level 2 is off");
+  zassert_true(pcf8576_emul_get_segment(emul, 2, 8), "sign is off");
+  zassert_true(pcf8576_emul_get_segment(emul, 0, 39), "segment 39 is off");
+
+  /* the direct macros render these widgets in full again */
+  nummemo_num_small.dev = NULL;
+  barmemo_bar_battery.dev = NULL;
+}
+#endif
+
+ZTEST(lcd_tests, test_emul_blink)
+{
+  const struct device *dev = DEVICE_DT_GET(LCD_DEV_NODELABEL);
+  const struct emul *emul = EMUL_DT_GET(LCD_DEV_NODELABEL);
+  struct pcf8576_emul_stats stats;
+
+  pcf8576_emul_reset_stats(emul);
+  zassert_ok(pcf8576_blink(dev, PCF8576_BLINK_1HZ, PCF8576_BLINK_NORMAL),
+             "blink failed");
+  zassert_equal(pcf8576_emul_get_blink(emul), 0x02, "blink not set");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.bytes, 2, "unexpected byte count");
+
+  /* 1:4 multiplexing has no alternate bank */
+  zassert_equal(pcf8576_blink(dev, PCF8576_BLINK_2HZ, PCF8576_BLINK_ALT_BANK),
+                -ENOTSUP, "alternate bank blinking accepted");
+  zassert_equal(pcf8576_emul_get_blink(emul), 0x02, "blink changed");
+
+  zassert_ok(pcf8576_blink(dev, PCF8576_BLINK_OFF, PCF8576_BLINK_NORMAL),
+             "blink failed");
+  zassert_equal(pcf8576_emul_get_blink(emul), 0x00, "blink not stopped");
+}
+
+#if DT_NODE_EXISTS(DT_NODELABEL(lcd_mux1))
+ZTEST(lcd_tests, test_emul_alt_bank)
+{
+  const struct device *dev = DEVICE_DT_GET(DT_NODELABEL(lcd_mux1));
+  const struct emul *emul = EMUL_DT_GET(DT_NODELABEL(lcd_mux1));
+  size_t byte = PCF8576_SEG_BYTE_MUX(1, 0, 45);
+  uint8_t value = PCF8576_SEG_MASK_MUX(1, 0, 45);
+
+  /* the chip setup cleared the undefined alternate bank, flushes keep
+   * writing bank 0 */
+  zassert_ok(lcd_write_segments(dev, &value, byte, 1), "write failed");
+  zassert_ok(lcd_flush(dev), "flush failed");
+  zassert_true(pcf8576_emul_get_bank_segment(emul, 0, 0, 45),
+               "segment is off");
+  for (uint16_t column = 0; column < 2 * PCF8576_COLUMNS; column++) {
+    zassert_false(pcf8576_emul_get_bank_segment(emul, 1, 0, column),
+                  "alternate bank not cleared");
+  }
+
+  zassert_ok(pcf8576_blink(dev, PCF8576_BLINK_1HZ, PCF8576_BLINK_ALT_BANK),
+             "blink failed");
+  zassert_equal(pcf8576_emul_get_blink(emul), 0x06, "blink not set");
+  zassert_ok(pcf8576_blink(dev, PCF8576_BLINK_OFF, PCF8576_BLINK_NORMAL),
+             "blink failed");
+}
+#endif
+
+#if DT_NODE_EXISTS(DT_NODELABEL(lcd_mux1)) &&                                 \
+    DT_NODE_EXISTS(DT_NODELABEL(lcd_mux2)) &&                                 \
+    DT_NODE_EXISTS(DT_NODELABEL(lcd_mux3))
+/* sets a single segment and checks that it alone is sent and shown */
+static void check_mux_segment(const struct device *dev, const struct emul *emul,
+                              uint8_t backplane, uint16_t column, size_t byte,
+                              uint8_t mask)
+{
+  struct pcf8576_emul_stats stats;
+
+  zassert_ok(lcd_flush(dev), "flush failed");
+  pcf8576_emul_reset_stats(emul);
+  zassert_ok(lcd_write_segments(dev, &mask, byte, 1), "write failed");
+  zassert_ok(lcd_flush(dev), "flush failed");
+
+  /* address, LOAD DATA POINTER, DEVICE SELECT and one RAM byte */
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 1, "unexpected transaction count");
+  zassert_equal(stats.bytes, 4, "unexpected byte count");
+  zassert_equal(stats.data_bytes, 1, "unexpected data byte count");
+  zassert_true(pcf8576_emul_get_segment(emul, backplane, column),
+               "segment is off");
+  if (backplane > 0) {
+    zassert_false(pcf8576_emul_get_segment(emul, backplane - 1, column),
+                  "neighbouring backplane is on");
+  }
+  zassert_false(pcf8576_emul_get_segment(emul, backplane, column - 1),
+                "neighbouring column is on");
+}
+
+ZTEST(lcd_tests, test_emul_mux_modes)
+{
+  const struct device *dev1 = DEVICE_DT_GET(DT_NODELABEL(lcd_mux1));
+  const struct device *dev2 = DEVICE_DT_GET(DT_NODELABEL(lcd_mux2));
+  const struct device *dev3 = DEVICE_DT_GET(DT_NODELABEL(lcd_mux3));
+  const struct emul *emul3 = EMUL_DT_GET(DT_NODELABEL(lcd_mux3));
+  struct pcf8576_emul_stats stats;
+  struct lcd_capabilities caps;
+
+  /* 8, 4 and 3 columns per RAM byte */
+  zassert_equal(PCF8576_SEG_BYTE_MUX(1, 0, 9), 1, "1:1 byte");
+  zassert_equal(PCF8576_SEG_MASK_MUX(1, 0, 9), 0x40, "1:1 mask");
+  zassert_equal(PCF8576_SEG_BYTE_MUX(2, 1, 5), 1, "1:2 byte");
+  zassert_equal(PCF8576_SEG_MASK_MUX(2, 1, 5), 0x10, "1:2 mask");
+  zassert_equal(PCF8576_SEG_BYTE_MUX(3, 2, 4), 1, "1:3 byte");
+  zassert_equal(PCF8576_SEG_MASK_MUX(3, 2, 4), 0x04, "1:3 mask");
+  /* row 2 of every third column is not stored */
+  zassert_equal(PCF8576_SEG_MASK_MUX(3, 2, 5), 0, "1:3 unstored row");
+  zassert_equal(PCF8576_SEG_MASK_MUX(2, 2, 5), 0, "undriven backplane");
+
+  check_mux_segment(dev1, EMUL_DT_GET(DT_NODELABEL(lcd_mux1)), 0, 9,
+                    PCF8576_SEG_BYTE_MUX(1, 0, 9),
+                    PCF8576_SEG_MASK_MUX(1, 0, 9));
+  check_mux_segment(dev2, EMUL_DT_GET(DT_NODELABEL(lcd_mux2)), 1, 5,
+                    PCF8576_SEG_BYTE_MUX(2, 1, 5),
+                    PCF8576_SEG_MASK_MUX(2, 1, 5));
+  check_mux_segment(dev3, emul3, 2, 4, PCF8576_SEG_BYTE_MUX(3, 2, 4),
+                    PCF8576_SEG_MASK_MUX(3, 2, 4));
+
+  /* 1:3 devices hold 14 bytes, the last one covers column 39 only */
+  zassert_ok(lcd_get_capabilities(dev3, &caps), "no capabilities");
+  zassert_equal(caps.ram_size, 2 * 14, "unexpected 1:3 RAM size");
+  zassert_equal(PCF8576_SEG_BYTE_MUX(3, 0, 38), 12, "1:3 byte");
+  zassert_equal(PCF8576_SEG_BYTE_MUX(3, 0, 39), 13, "1:3 last byte");
+  zassert_equal(PCF8576_SEG_BYTE_MUX(3, 0, 40), 14, "1:3 next device");
+
+  /* a span across the device boundary is sent in one transaction */
+  uint8_t span[2] = {
+      PCF8576_SEG_MASK_MUX(3, 0, 39) | PCF8576_SEG_MASK_MUX(3, 2, 39),
+      PCF8576_SEG_MASK_MUX(3, 1, 41)};
+
+  zassert_ok(lcd_flush(dev3), "flush failed");
+  pcf8576_emul_reset_stats(emul3);
+  zassert_ok(lcd_write_segments(dev3, span, PCF8576_SEG_BYTE_MUX(3, 0, 39),
+                                sizeof(span)),
+             "write failed");
+  zassert_ok(lcd_flush(dev3), "flush failed");
+  pcf8576_emul_get_stats(emul3, &stats);
+  zassert_equal(stats.transactions, 1, "unexpected transaction count");
+  zassert_equal(stats.data_bytes, 2, "unexpected data byte count");
+  zassert_true(pcf8576_emul_get_segment(emul3, 0, 39), "segment is off");
+  zassert_true(pcf8576_emul_get_segment(emul3, 2, 39), "segment is off");
+  zassert_false(pcf8576_emul_get_segment(emul3, 1, 39), "segment is on");
+  zassert_true(pcf8576_emul_get_segment(emul3, 1, 41), "segment is off");
+  zassert_false(pcf8576_emul_get_segment(emul3, 1, 40), "segment is on");
+}
+#endif
+
+#if DT_NODE_EXISTS(DT_NODELABEL(lcd_bank))
+/* BANK SELECT command with input bank i and output bank o */
+#define TEST_BANK_SELECT(i, o) (0x78 | ((i) << 1) | (o))
+
+struct bank_swap {
+  bool shown_before;
+  uint8_t prefix;
+  uint8_t tail;
+  int msgs;
+};
+
+static int bank_swap_hook(const struct emul *target, const struct i2c_msg *msgs,
+                          int num_msgs, void *user_data)
+{
+  struct bank_swap *swap = user_data;
+  const struct i2c_msg *last = &msgs[num_msgs - 1];
+
+  swap->shown_before = pcf8576_emul_get_segment(target, 1, 10);
+  swap->prefix = msgs[0].buf[0];
+  swap->tail = last->buf[last->len - 1];
+  swap->msgs = num_msgs;
+  return 0;
+}
+
+ZTEST(lcd_tests, test_emul_bank)
+{
+  const struct device *dev = DEVICE_DT_GET(DT_NODELABEL(lcd_bank));
+  const struct emul *emul = EMUL_DT_GET(DT_NODELABEL(lcd_bank));
+  size_t byte = PCF8576_SEG_BYTE_MUX(2, 1, 10);
+  uint8_t value = PCF8576_SEG_MASK_MUX(2, 1, 10);
+  struct bank_swap swap;
+  uint8_t shown;
+  uint8_t hidden;
+
+  zassert_ok(lcd_flush(dev), "flush failed");
+  shown = pcf8576_emul_get_bank(emul) & 0x01;
+  hidden = shown ^ 1;
+
+  /* the frame goes into the hidden bank behind a BANK SELECT prefix, the
+   * old frame is shown until the trailing BANK SELECT swaps the banks */
+  pcf8576_emul_set_transfer_hook(emul, bank_swap_hook, &swap);
+  zassert_ok(lcd_write_segments(dev, &value, byte, 1), "write failed");
+  zassert_ok(lcd_flush(dev), "flush failed");
+  zassert_equal(swap.msgs, 2, "unexpected message count");
+  zassert_equal(swap.prefix, 0x80 | TEST_BANK_SELECT(hidden, shown),
+                "unexpected prefix");
+  zassert_equal(swap.tail, TEST_BANK_SELECT(shown, hidden),
+                "unexpected swap");
+  zassert_false(swap.shown_before, "new frame shown before the swap");
+  zassert_true(pcf8576_emul_get_segment(emul, 1, 10), "segment is off");
+  zassert_equal(pcf8576_emul_get_bank(emul) & 0x01, hidden, "no swap");
+  pcf8576_emul_set_transfer_hook(emul, NULL, NULL);
+
+  /* preloaded into the hidden bank and shown on demand */
+  shown = hidden;
+  hidden = shown ^ 1;
+  value = 0;
+  zassert_ok(lcd_write_segments(dev, &value, byte, 1), "write failed");
+  zassert_ok(pcf8576_flush_bank(dev, hidden), "flush failed");
+  zassert_true(pcf8576_emul_get_segment(emul, 1, 10),
+               "new frame shown before the swap");
+  zassert_false(pcf8576_emul_get_bank_segment(emul, hidden, 1, 10),
+                "hidden bank not written");
+  zassert_ok(pcf8576_bank_show(dev, hidden), "show failed");
+  zassert_false(pcf8576_emul_get_segment(emul, 1, 10), "segment is on");
+
+  zassert_equal(pcf8576_flush_bank(dev, 2), -EINVAL, "bank 2 accepted");
+  zassert_equal(pcf8576_bank_show(dev, 2), -EINVAL, "bank 2 accepted");
+  zassert_equal(pcf8576_blink(dev, PCF8576_BLINK_1HZ, PCF8576_BLINK_ALT_BANK),
+                -EBUSY, "alternate bank blinking accepted");
+  zassert_equal(pcf8576_flush_bank(DEVICE_DT_GET(LCD_DEV_NODELABEL), 0),
+                -ENOTSUP, "bank flush of an unbuffered device");
+}
+#endif
+
+#if DT_NODE_EXISTS(DT_NODELABEL(lcd_mux1))
+ZTEST(lcd_tests, test_emul_cascade)
+{
+  const struct device *dev = DEVICE_DT_GET(DT_NODELABEL(lcd_mux1));
+  const struct emul *emul = EMUL_DT_GET(DT_NODELABEL(lcd_mux1));
+  struct pcf8576_emul_stats stats;
+  size_t last = PCF8576_SEG_BYTE_MUX(1, 0, 39);
+  uint8_t span[2] = {PCF8576_SEG_MASK_MUX(1, 0, 39),
+                     PCF8576_SEG_MASK_MUX(1, 0, 40)};
+  uint8_t value = PCF8576_SEG_MASK_MUX(1, 0, 60);
+
+  zassert_equal(PCF8576_SEG_BYTE_MUX(1, 0, 40), last + 1,
+                "second device does not follow the first one");
+
+  /* the data stream continues from the last column of the first device
+   * into the second one, within a single transaction */
+  zassert_ok(lcd_flush(dev), "flush failed");
+  pcf8576_emul_reset_stats(emul);
+  zassert_ok(lcd_write_segments(dev, span, last, sizeof(span)),
+             "write failed");
+  zassert_ok(lcd_flush(dev), "flush failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 1, "unexpected transaction count");
+  zassert_equal(stats.data_bytes, 2, "unexpected data byte count");
+  zassert_true(pcf8576_emul_get_segment(emul, 0, 39), "segment 39 is off");
+  zassert_true(pcf8576_emul_get_segment(emul, 0, 40), "segment 40 is off");
+  zassert_false(pcf8576_emul_get_segment(emul, 0, 41), "segment 41 is on");
+
+  /* a span on the second device selects it directly */
+  pcf8576_emul_reset_stats(emul);
+  zassert_ok(lcd_write_segments(dev, &value, PCF8576_SEG_BYTE_MUX(1, 0, 60),
+                                1),
+             "write failed");
+  zassert_ok(lcd_flush(dev), "flush failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.data_bytes, 1, "unexpected data byte count");
+  zassert_true(pcf8576_emul_get_segment(emul, 0, 60), "segment 60 is off");
+  zassert_false(pcf8576_emul_get_segment(emul, 0, 20), "first device written");
+}
+#endif
+
+#if defined(CONFIG_PCF8576_ASYNC) && DT_NODE_EXISTS(DT_NODELABEL(lcd_mux1))
+enum {
+  ASYNC_TRANSFER = 1,
+  ASYNC_DONE,
+};
+
+struct async_log {
+  const struct device *dev;
+  struct k_sem done;
+  int events[4];
+  int count;
+  int result;
+  int busy;
+  int fail;
+};
+
+static int async_hook(const struct emul *target, const struct i2c_msg *msgs,
+                      int num_msgs, void *user_data)
+{
+  struct async_log *log = user_data;
+
+  log->events[log->count++] = ASYNC_TRANSFER;
+  /* the transmit buffer of the running transfer is still in use */
+  log->busy = pcf8576_flush_async(log->dev, NULL, NULL);
+  return log->fail;
+}
+
+static void async_cb(const struct device *dev, int result, void *user_data)
+{
+  struct async_log *log = user_data;
+
+  log->events[log->count++] = ASYNC_DONE;
+  log->result = result;
+  k_sem_give(&log->done);
+}
+
+static void async_log_reset(struct async_log *log)
+{
+  log->count = 0;
+  log->result = 1;
+  log->busy = 0;
+}
+
+ZTEST(lcd_tests, test_emul_async)
+{
+  const struct device *dev = DEVICE_DT_GET(DT_NODELABEL(lcd_mux1));
+  const struct emul *emul = EMUL_DT_GET(DT_NODELABEL(lcd_mux1));
+  static struct async_log log;
+  uint8_t value = PCF8576_SEG_MASK_MUX(1, 0, 12);
+
+  log.dev = dev;
+  log.fail = 0;
+  k_sem_init(&log.done, 0, 1);
+  zassert_ok(lcd_flush(dev), "flush failed");
+  pcf8576_emul_set_transfer_hook(emul, async_hook, &log);
+
+  /* the callback reports the completed transfer, a second flush is
+   * refused while it is running */
+  async_log_reset(&log);
+  zassert_ok(lcd_write_segments(dev, &value, PCF8576_SEG_BYTE_MUX(1, 0, 12),
+                                1),
+             "write failed");
+  zassert_ok(pcf8576_flush_async(dev, async_cb, &log), "flush failed");
+  zassert_ok(k_sem_take(&log.done, K_SECONDS(1)), "no callback");
+  zassert_equal(log.count, 2, "unexpected event count");
+  zassert_equal(log.events[0], ASYNC_TRANSFER, "callback before transfer");
+  zassert_equal(log.events[1], ASYNC_DONE, "no callback after transfer");
+  zassert_equal(log.result, 0, "transfer failed");
+  zassert_equal(log.busy, -EBUSY, "overlapping flush accepted");
+  zassert_true(pcf8576_emul_get_segment(emul, 0, 12), "segment 12 is off");
+
+  /* nothing changed, the callback is called without a transfer */
+  async_log_reset(&log);
+  zassert_ok(pcf8576_flush_async(dev, async_cb, &log), "flush failed");
+  zassert_ok(k_sem_take(&log.done, K_SECONDS(1)), "no callback");
+  zassert_equal(log.count, 1, "unexpected event count");
+  zassert_equal(log.events[0], ASYNC_DONE, "unexpected transfer");
+  zassert_equal(log.result, 0, "unexpected result");
+
+  /* a failed transfer is reported and its changes are sent again */
+  async_log_reset(&log);
+  log.fail = -EIO;
+  value = PCF8576_SEG_MASK_MUX(1, 0, 13);
+  zassert_ok(lcd_write_segments(dev, &value, PCF8576_SEG_BYTE_MUX(1, 0, 13),
+                                1),
+             "write failed");
+  zassert_ok(pcf8576_flush_async(dev, async_cb, &log), "flush failed");
+  zassert_ok(k_sem_take(&log.done, K_SECONDS(1)), "no callback");
+  zassert_equal(log.result, -EIO, "failure not reported");
+  zassert_false(pcf8576_emul_get_segment(emul, 0, 13), "segment 13 is on");
+  log.fail = 0;
+  zassert_ok(lcd_flush(dev), "flush failed");
+  zassert_true(pcf8576_emul_get_segment(emul, 0, 13), "segment 13 is off");
+  pcf8576_emul_set_transfer_hook(emul, NULL, NULL);
+}
+
+ZTEST(lcd_tests, test_emul_signal)
+{
+  const struct device *dev = DEVICE_DT_GET(DT_NODELABEL(lcd_mux1));
+  const struct emul *emul = EMUL_DT_GET(DT_NODELABEL(lcd_mux1));
+  uint8_t value = PCF8576_SEG_MASK_MUX(1, 0, 14);
+  struct k_poll_signal sig;
+  struct k_poll_event event = K_POLL_EVENT_INITIALIZER(
+      K_POLL_TYPE_SIGNAL, K_POLL_MODE_NOTIFY_ONLY, &sig);
+  unsigned int signaled;
+  int result;
+
+  k_poll_signal_init(&sig);
+  zassert_ok(lcd_write_segments(dev, &value, PCF8576_SEG_BYTE_MUX(1, 0, 14),
+                                1),
+             "write failed");
+  zassert_ok(pcf8576_flush_signal(dev, &sig), "flush failed");
+  zassert_ok(k_poll(&event, 1, K_SECONDS(1)), "not signaled");
+  k_poll_signal_check(&sig, &signaled, &result);
+  zassert_true(signaled, "not signaled");
+  zassert_equal(result, 0, "transfer failed");
+  zassert_true(pcf8576_emul_get_segment(emul, 0, 14), "segment 14 is off");
+}
+
+#if DT_NODE_EXISTS(DT_NODELABEL(lcd_bank)) &&                                 \
+    DT_NODE_EXISTS(DT_NODELABEL(lcd_mux2))
+struct group_log {
+  const struct emul *order[4];
+  int count;
+  const struct emul *fail;
+};
+
+static int group_hook(const struct emul *target, const struct i2c_msg *msgs,
+                      int num_msgs, void *user_data)
+{
+  struct group_log *log = user_data;
+
+  log->order[log->count++] = target;
+  return target == log->fail ? -EIO : 0;
+}
+
+ZTEST(lcd_tests, test_emul_group)
+{
+  /* lcd_mux1 and lcd_bank share a bus, lcd_mux2 is on another one */
+  const struct device *const devs[] = {
+      DEVICE_DT_GET(DT_NODELABEL(lcd_mux1)),
+      DEVICE_DT_GET(DT_NODELABEL(lcd_bank)),
+      DEVICE_DT_GET(DT_NODELABEL(lcd_mux2)),
+  };
+  const struct emul *const emuls[] = {
+      EMUL_DT_GET(DT_NODELABEL(lcd_mux1)),
+      EMUL_DT_GET(DT_NODELABEL(lcd_bank)),
+      EMUL_DT_GET(DT_NODELABEL(lcd_mux2)),
+  };
+  uint8_t value[] = {PCF8576_SEG_MASK_MUX(1, 0, 15),
+                     PCF8576_SEG_MASK_MUX(2, 0, 20),
+                     PCF8576_SEG_MASK_MUX(2, 1, 5)};
+  const size_t byte[] = {PCF8576_SEG_BYTE_MUX(1, 0, 15),
+                         PCF8576_SEG_BYTE_MUX(2, 0, 20),
+                         PCF8576_SEG_BYTE_MUX(2, 1, 5)};
+  struct group_log log = {0};
+  int first = -1;
+  int second = -1;
+
+  for (size_t idx = 0; idx < ARRAY_SIZE(devs); idx++) {
+    uint8_t off = 0;
+
+    zassert_ok(lcd_write_segments(devs[idx], &off, byte[idx], 1),
+               "write failed");
+    zassert_ok(lcd_flush(devs[idx]), "flush failed");
+    pcf8576_emul_set_transfer_hook(emuls[idx], group_hook, &log);
+    zassert_ok(lcd_write_segments(devs[idx], &value[idx], byte[idx], 1),
+               "write failed");
+  }
+
+  /* every device is flushed once, the devices of a bus in array order */
+  zassert_ok(pcf8576_flush_group(devs, ARRAY_SIZE(devs)), "flush failed");
+  zassert_equal(log.count, 3, "unexpected transfer count");
+  for (int idx = 0; idx < log.count; idx++) {
+    if (log.order[idx] == emuls[0]) {
+      first = idx;
+    } else if (log.order[idx] == emuls[1]) {
+      second = idx;
+    }
+  }
+  zassert_true(first >= 0 && first < second, "bus order not kept");
+  zassert_true(pcf8576_emul_get_segment(emuls[0], 0, 15), "lcd_mux1 is off");
+  zassert_true(pcf8576_emul_get_segment(emuls[1], 0, 20), "lcd_bank is off");
+  zassert_true(pcf8576_emul_get_segment(emuls[2], 1, 5), "lcd_mux2 is off");
+
+  /* unchanged devices complete without a transfer */
+  log.count = 0;
+  zassert_ok(pcf8576_flush_group(devs, ARRAY_SIZE(devs)), "flush failed");
+  zassert_equal(log.count, 0, "unexpected transfer");
+
+  /* the failure of one device is returned after the others completed */
+  log.fail = emuls[1];
+  for (size_t idx = 0; idx < ARRAY_SIZE(devs); idx++) {
+    value[idx] = 0;
+    zassert_ok(lcd_write_segments(devs[idx], &value[idx], byte[idx], 1),
+               "write failed");
+  }
+  zassert_equal(pcf8576_flush_group(devs, ARRAY_SIZE(devs)), -EIO,
+                "failure not reported");
+  zassert_equal(log.count, 3, "unexpected transfer count");
+  zassert_false(pcf8576_emul_get_segment(emuls[0], 0, 15), "lcd_mux1 is on");
+  zassert_true(pcf8576_emul_get_segment(emuls[1], 0, 20), "lcd_bank is off");
+  zassert_false(pcf8576_emul_get_segment(emuls[2], 1, 5), "lcd_mux2 is on");
+
+  for (size_t idx = 0; idx < ARRAY_SIZE(devs); idx++) {
+    pcf8576_emul_set_transfer_hook(emuls[idx], NULL, NULL);
+  }
+  zassert_ok(lcd_flush(devs[1]), "flush failed");
+  zassert_false(pcf8576_emul_get_segment(emuls[1], 0, 20), "lcd_bank is on");
+}
+#endif
+#endif
+
+#if defined(CONFIG_PCF8576_FLUSH_COALESCE) &&                                  \
+    DT_NODE_EXISTS(DT_NODELABEL(lcd_mux1))
+ZTEST(lcd_tests, test_emul_coalesce)
+{
+  const struct device *dev = DEVICE_DT_GET(DT_NODELABEL(lcd_mux1));
+  const struct emul *emul = EMUL_DT_GET(DT_NODELABEL(lcd_mux1));
+  struct pcf8576_emul_stats stats;
+  uint8_t value = PCF8576_SEG_MASK_MUX(1, 0, 8);
+
+  /* a first request starts a new period */
+  pcf8576_emul_reset_stats(emul);
+  zassert_ok(lcd_write_segments(dev, &value, PCF8576_SEG_BYTE_MUX(1, 0, 8),
+                                1),
+             "write failed");
+  pcf8576_flush_request(dev);
+  for (int ms = 0; ms < 2 * CONFIG_PCF8576_FLUSH_PERIOD_MS; ms++) {
+    pcf8576_emul_get_stats(emul, &stats);
+    if (stats.transactions) {
+      break;
+    }
+    k_msleep(1);
+  }
+  zassert_equal(stats.transactions, 1, "request not served");
+
+  /* the requests within the period, one per RAM byte, are served by a
+   * single transfer at its end */
+  pcf8576_emul_reset_stats(emul);
+  for (int col = 16; col <= 32; col += 8) {
+    value = PCF8576_SEG_MASK_MUX(1, 0, col);
+    zassert_ok(lcd_write_segments(dev, &value,
+                                  PCF8576_SEG_BYTE_MUX(1, 0, col), 1),
+               "write failed");
+    pcf8576_flush_request(dev);
+  }
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 0, "request served within the period");
+  k_msleep(2 * CONFIG_PCF8576_FLUSH_PERIOD_MS);
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 1, "unexpected transaction count");
+  zassert_equal(stats.data_bytes, 3, "unexpected data byte count");
+  for (int col = 8; col <= 32; col += 8) {
+    zassert_true(pcf8576_emul_get_segment(emul, 0, col), "segment is off");
+  }
+}
+#endif
+
+#ifdef CONFIG_PM_DEVICE
+ZTEST(lcd_tests, test_emul_pm)
+{
+  const struct device *dev = DEVICE_DT_GET(LCD_DEV_NODELABEL);
+  const struct emul *emul = EMUL_DT_GET(LCD_DEV_NODELABEL);
+  struct pcf8576_emul_stats stats;
+
+  pcf8576_num_int(dev, num_small, 2);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  zassert_ok(pm_device_action_run(dev, PM_DEVICE_ACTION_SUSPEND),
+             "suspend failed");
+  zassert_equal(pcf8576_emul_get_mode(emul) & BIT(3), 0, "display is on");
+
+  /* changes made while suspended are sent by the resume */
+  pcf8576_emul_reset_stats(emul);
+  pcf8576_num_int(dev, num_small, 3);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 0, "suspended device was written");
+
+  zassert_ok(pm_device_action_run(dev, PM_DEVICE_ACTION_RESUME),
+             "resume failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 1, "unexpected transaction count");
+  zassert_equal(stats.data_bytes, 20, "RAM not restored");
+  zassert_not_equal(pcf8576_emul_get_mode(emul) & BIT(3), 0, "display is off");
+  /* digit 4 shows "3": segment c on */
+  zassert_true(pcf8576_emul_get_segment(emul, 1, 7), "segment 4c is off");
+}
+#endif
+
+#ifdef CONFIG_PCF8576_IDLE_SUSPEND
+ZTEST(lcd_tests, test_emul_idle)
+{
+  const struct device *dev = DEVICE_DT_GET(LCD_DEV_NODELABEL);
+  const struct emul *emul = EMUL_DT_GET(LCD_DEV_NODELABEL);
+  struct pcf8576_emul_stats stats;
+
+  pcf8576_num_int(dev, num_small, 5);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  k_msleep(CONFIG_PCF8576_IDLE_TIMEOUT_S * MSEC_PER_SEC + 100);
+  zassert_equal(pcf8576_emul_get_mode(emul) & BIT(3), 0, "display is on");
+
+  /* the next flush powers the display up in the same transaction */
+  pcf8576_emul_reset_stats(emul);
+  pcf8576_num_int(dev, num_small, 6);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 1, "unexpected transaction count");
+  zassert_not_equal(pcf8576_emul_get_mode(emul) & BIT(3), 0, "display is off");
+}
+#endif
+
+#ifdef CONFIG_PCF8576_MARQUEE
+/* waits for the marquee to flush its count-th window since the last stats
+ * reset, every window differs from the previous one */
+static bool marquee_wait(const struct emul *emul, uint32_t count)
+{
+  struct pcf8576_emul_stats stats;
+
+  for (int ms = 0; ms < MSEC_PER_SEC; ms++) {
+    pcf8576_emul_get_stats(emul, &stats);
+    if (stats.transactions >= count) {
+      return stats.transactions == count;
+    }
+    k_msleep(1);
+  }
+  return false;
+}
+
+ZTEST(lcd_tests, test_emul_marquee)
+{
+  const struct device *dev = DEVICE_DT_GET(LCD_DEV_NODELABEL);
+  const struct emul *emul = EMUL_DT_GET(LCD_DEV_NODELABEL);
+  static const char *const frames[] = {"1", "1.1"};
+  static struct pcf8576_marquee mq;
+  struct pcf8576_emul_stats stats;
+
+  pcf8576_marquee_init(&mq, dev, num_small);
+  zassert_equal(pcf8576_marquee_text(&mq, ".1", 10, false), -EINVAL,
+                "leading decimal point accepted");
+  zassert_equal(pcf8576_marquee_text(&mq, "1a", 10, false), -EINVAL,
+                "letter accepted");
+  zassert_equal(pcf8576_marquee_frames(&mq, frames, 1, 0, false), -EINVAL,
+                "zero period accepted");
+
+  /* "1" enters at digit 4 and stops at digit 1 after four windows */
+  pcf8576_num_int(dev, num_small, 8888);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  pcf8576_emul_reset_stats(emul);
+  zassert_ok(pcf8576_marquee_text(&mq, "1", 10, false), "marquee failed");
+  zassert_true(marquee_wait(emul, 1), "first window not shown");
+  zassert_true(pcf8576_emul_get_segment(emul, 2, 7), "segment 4b is off");
+  zassert_false(pcf8576_emul_get_segment(emul, 2, 1), "segment 1b is on");
+  zassert_true(marquee_wait(emul, 4), "last window not shown");
+  zassert_false(pcf8576_emul_get_segment(emul, 2, 7), "segment 4b is on");
+  zassert_true(pcf8576_emul_get_segment(emul, 2, 1), "segment 1b is off");
+  k_msleep(50);
+  pcf8576_emul_get_stats(emul, &stats);
+  zassert_equal(stats.transactions, 4, "marquee did not stop");
+
+  /* frames are right aligned */
+  pcf8576_emul_reset_stats(emul);
+  zassert_ok(pcf8576_marquee_frames(&mq, frames, ARRAY_SIZE(frames), 10, true),
+             "marquee failed");
+  zassert_true(marquee_wait(emul, 1), "first frame not shown");
+  zassert_true(pcf8576_emul_get_segment(emul, 2, 7), "segment 4b is off");
+  zassert_false(pcf8576_emul_get_segment(emul, 2, 1), "segment 1b is on");
+  zassert_true(marquee_wait(emul, 2), "second frame not shown");
+  zassert_true(pcf8576_emul_get_segment(emul, 2, 5), "segment 3b is off");
+  pcf8576_marquee_stop(&mq);
+
+  /* the widget is rendered normally after the marquee */
+  pcf8576_num_int(dev, num_small, 1);
+  zassert_ok(pcf8576_flush(dev), "flush failed");
+  zassert_true(pcf8576_emul_get_segment(emul, 2, 7), "segment 4b is off");
+  zassert_false(pcf8576_emul_get_segment(emul, 2, 5), "segment 3b is on");
+}
+#endif
+#endif
+
 #endif